@@ -27,6 +27,10 @@ typedef enum {
     VOYAGER_ERROR_NOT_IMPLEMENTED,
     /// @brief The voyager library has encountered an error without a specific error code map.
     VOYAGER_ERROR_GENERIC_ERROR,
+    /// @brief The voyager library has no free receive buffer to lend to the transport
+    VOYAGER_ERROR_BUFFER_FULL,
+    /// @brief An asynchronous flash operation has been started and will be completed through voyager_bootloader_hal_op_complete
+    VOYAGER_ERROR_BUSY,
 } voyager_error_E;
 
 /// @brief Error codes for the voyager DFU subsystem
@@ -47,6 +51,20 @@ typedef enum {
     VOYAGER_DFU_ERROR_SIZE_TOO_LARGE,
     /// @brief The voyager DFU subsystem has encountered an error due to an internal processing error
     VOYAGER_DFU_ERROR_INTERNAL_ERROR,
+    /// @brief The voyager DFU subsystem has rejected a DFU start packet requesting a transfer option it does not support
+    VOYAGER_DFU_ERROR_UNSUPPORTED_FEATURE,
+    /// @brief The voyager DFU subsystem has encountered an error due to recieving a compressed DFU data packet that does
+    /// not decompress
+    VOYAGER_DFU_ERROR_INVALID_COMPRESSED_DATA,
+    /// @brief The voyager DFU subsystem has rejected a delta DFU start packet whose patch was generated against a different
+    /// application than the one in flash
+    VOYAGER_DFU_ERROR_BASE_IMAGE_MISMATCH,
+    /// @brief The voyager DFU subsystem has encountered an error due to recieving a delta update patch that is malformed or
+    /// does not reconstruct the announced application
+    VOYAGER_DFU_ERROR_INVALID_PATCH,
+    /// @brief The voyager DFU subsystem has rejected a resuming DFU start packet because no checkpoint of that application
+    /// is stored
+    VOYAGER_DFU_ERROR_NO_CHECKPOINT,
 } voyager_dfu_error_E;
 
 /// @brief The current state of the voyager bootloader
@@ -77,6 +95,17 @@ typedef enum {
     VOYAGER_NVM_KEY_APP_END_ADDRESS,
     /// @brief The size of the application in flash
     VOYAGER_NVM_KEY_APP_SIZE,
+    /// @brief The application CRC that the image in flash was last verified against. Equal to VOYAGER_NVM_KEY_APP_CRC
+    /// when the current image has been verified
+    VOYAGER_NVM_KEY_APP_VERIFIED_CRC,
+    /// @brief The number of boots that skipped flash verification since the image was last verified
+    VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY,
+    /// @brief Identifies the DFU the stored checkpoint belongs to, derived from the size and CRC in its start packet
+    VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION,
+    /// @brief The number of application bytes in flash when the checkpoint was taken
+    VOYAGER_NVM_KEY_DFU_CHECKPOINT_OFFSET,
+    /// @brief The running CRC of the application bytes in flash when the checkpoint was taken
+    VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC,
 } voyager_nvm_key_E;
 
 /// @brief The requests that can be made to the voyager bootloader
@@ -95,6 +124,8 @@ typedef uintptr_t voyager_bootloader_addr_size_t;
 typedef uint32_t voyager_bootloader_app_crc_t;
 /// @brief Size of app sizes in the voyager bootloader library
 typedef uint32_t voyager_bootloader_app_size_t;
+/// @brief Size of boot counters in the voyager bootloader library
+typedef uint32_t voyager_bootloader_boot_count_t;
 
 /// @brief Non-volatile memory data for the voyager bootloader library
 typedef union {
@@ -106,8 +137,29 @@ typedef union {
     voyager_bootloader_addr_size_t app_end_address;
     /// @brief The size of the application in flash
     voyager_bootloader_app_size_t app_size;
+    /// @brief The application CRC that the image in flash was last verified against
+    voyager_bootloader_app_crc_t app_verified_crc;
+    /// @brief The number of boots that skipped flash verification since the image was last verified
+    voyager_bootloader_boot_count_t boots_since_verify;
+    /// @brief Identifies the DFU the stored checkpoint belongs to
+    uint32_t dfu_checkpoint_session;
+    /// @brief The number of application bytes in flash when the checkpoint was taken
+    voyager_bootloader_app_size_t dfu_checkpoint_offset;
+    /// @brief The running CRC of the application bytes in flash when the checkpoint was taken
+    voyager_bootloader_app_crc_t dfu_checkpoint_crc;
 } voyager_bootloader_nvm_data_t;
 
+/**
+ * @brief voyager_flash_sector_info_F Function pointer signature for looking up the erase sector holding an address
+ * @param address The flash address to look up
+ * @param sector_start Set to the first address of the sector holding address
+ * @param sector_end Set to the first address after the sector holding address
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+typedef voyager_error_E (*voyager_flash_sector_info_F)(const voyager_bootloader_addr_size_t address,
+                                                       voyager_bootloader_addr_size_t *const sector_start,
+                                                       voyager_bootloader_addr_size_t *const sector_end);
+
 /**
  * @brief voyager_custom_crc_stream_F Function pointer signature for a custom CRC stream function
  * @param byte The byte to process
@@ -115,12 +167,74 @@ typedef union {
  */
 typedef void (*voyager_custom_crc_stream_F)(const uint8_t byte, voyager_bootloader_app_crc_t *const crc);
 
+/**
+ * @brief voyager_custom_crc_block_F Function pointer signature for a custom CRC block function
+ * @param data The bytes to process
+ * @param length The number of bytes to process
+ * @param crc pointer to the current CRC value that is expected to be modified
+ * @note Intended for feeding whole buffers into a hardware CRC unit or DMA engine
+ */
+typedef void (*voyager_custom_crc_block_F)(const uint8_t *const data, const size_t length,
+                                           voyager_bootloader_app_crc_t *const crc);
+
+/// @brief Policies for verifying the application flash before jumping to it
+typedef enum {
+    /// @brief Verify the application flash on every jump to the application
+    VOYAGER_VERIFY_POLICY_ALWAYS = 0,
+    /// @brief Verify the application flash once after it is written, then jump to it immediately on later boots
+    VOYAGER_VERIFY_POLICY_ONCE_AFTER_DFU,
+    /// @brief Verify the application flash once after it is written and then on every Nth boot
+    VOYAGER_VERIFY_POLICY_EVERY_N_BOOTS,
+} voyager_verify_policy_E;
+
 /// @brief Configuration and feature flags for the voyager bootloader
 typedef struct {
     /// @brief Controls whether the bootloader should jump to the application after receiving a complete DFU or return to IDLE
     bool jump_to_app_after_dfu_recv_complete;
     /// @brief Enables the use of a custom CRC stream function to calculate the CRC of the application
     voyager_custom_crc_stream_F custom_crc_stream;
+    /// @brief Enables the use of a custom CRC block function to calculate the CRC of the application. Takes precedence
+    /// over custom_crc_stream when both are set
+    voyager_custom_crc_block_F custom_crc_block;
+    /// @brief Accumulates the CRC of the application as DFU payloads are written, so that the application does not need to
+    /// be re-read from flash before jumping to it after the DFU completes
+    bool verify_crc_during_dfu;
+    /// @brief When verify_crc_during_dfu is set, reads back each written payload from flash and accumulates the CRC over the
+    /// read back data rather than the received payload
+    bool readback_flash_during_dfu;
+    /// @brief Controls when the application flash is verified before jumping to it. Policies other than
+    /// VOYAGER_VERIFY_POLICY_ALWAYS require the VOYAGER_NVM_KEY_APP_VERIFIED_CRC key to be stored
+    voyager_verify_policy_E verify_policy;
+    /// @brief The boot interval at which the application flash is verified with VOYAGER_VERIFY_POLICY_EVERY_N_BOOTS. Also
+    /// requires the VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY key to be stored
+    voyager_bootloader_boot_count_t verify_every_n_boots;
+    /// @brief The maximum number of application bytes verified per call to voyager_bootloader_run, bounding the time spent
+    /// in a single call. 0 verifies the whole application in one call
+    voyager_bootloader_app_size_t verify_bytes_per_run;
+    /// @brief Buffers DFU payloads and writes them to flash as whole pages aligned to VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE,
+    /// plus the partial pages at either end of the application. Ignored if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE is 0
+    bool coalesce_flash_writes;
+    /// @brief Enables lazy erase. Instead of erasing the whole partition when a DFU starts, each sector is erased just
+    /// before the first write into it, using this function to find the sector boundaries
+    voyager_flash_sector_info_F flash_sector_info;
+    /// @brief Skips writing runs of VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE, such as padding, since freshly erased flash
+    /// already holds them. When coalescing, only pages made up entirely of the erased value are skipped
+    bool skip_erased_writes;
+    /// @brief Start of the flash region delta updates reconstruct the new application in before it is copied over the
+    /// current one. It must not overlap the application partition
+    voyager_bootloader_addr_size_t delta_staging_start_address;
+    /// @brief End of the delta update staging region, equal to the start to reject delta updates
+    voyager_bootloader_addr_size_t delta_staging_end_address;
+    /// @brief Stores a checkpoint in NVM every time this many more application bytes are in flash, so that a host can
+    /// resume an interrupted DFU from it. Must be a multiple of the erase sector size, since the flash after the
+    /// checkpoint is erased again on resume. With flash_sector_info, a checkpoint that is not at the start of a sector
+    /// is reported as missing rather than resumed from. Requires the VOYAGER_NVM_KEY_DFU_CHECKPOINT_* keys to be
+    /// stored. 0 disables checkpoints. Compressed and delta updates are not checkpointed
+    voyager_bootloader_app_size_t dfu_checkpoint_interval;
+    /// @brief With lazy erase, erases the sectors ahead of the incoming application one per call to voyager_bootloader_run
+    /// while no packet is waiting, so that erasing overlaps the host sending the next packets. Sectors a packet reaches
+    /// first are still erased on demand. Ignored without flash_sector_info
+    bool background_erase;
 } voyager_bootloader_config_t;
 
 /** Primary Bootloader Functions **/
@@ -153,9 +267,50 @@ voyager_error_E voyager_bootloader_run(void);
  * @note this function does perform error correction or verification - it
  * assumes the data link layer has already done this and the data is physically
  * valid.
+ * @note this function may be called from an interrupt while voyager_bootloader_run
+ * executes in the main loop, provided there is only one caller at a time. Packets are
+ * handed over through a lock-free queue guarded by VOYAGER_BOOTLOADER_MEMORY_BARRIER().
  */
 voyager_error_E voyager_bootloader_process_receieved_packet(uint8_t const *const data, size_t const length);
 
+/**
+ * @brief voyager_bootloader_acquire_rx_buffer Lends the next free receive buffer to the transport
+ * so a packet can be received into it directly (e.g. by DMA) instead of being copied
+ * @param buffer Set to the start of the receive buffer
+ * @param capacity Set to the number of bytes that can be written to the receive buffer
+ * @return VOYAGER_ERROR_NONE if successful, VOYAGER_ERROR_BUFFER_FULL if every receive
+ * buffer is waiting to be processed, otherwise an error code
+ *
+ * @note the same buffer is returned until voyager_bootloader_commit_rx is called
+ * @note unlike voyager_bootloader_process_receieved_packet, a full queue is not reported
+ * to the host as an overrun. The transport should apply flow control or retry after
+ * voyager_bootloader_run has processed a packet
+ */
+voyager_error_E voyager_bootloader_acquire_rx_buffer(uint8_t **const buffer, size_t *const capacity);
+
+/**
+ * @brief voyager_bootloader_commit_rx Hands a packet received into the buffer from
+ * voyager_bootloader_acquire_rx_buffer over to the bootloader for processing
+ * @param length The length of the packet written into the buffer
+ * @return VOYAGER_ERROR_NONE if successful, VOYAGER_ERROR_INVALID_ARGUMENT if no buffer was acquired since the
+ * last commit, otherwise an error code
+ *
+ * @note the same single-producer rules as voyager_bootloader_process_receieved_packet apply
+ */
+voyager_error_E voyager_bootloader_commit_rx(size_t const length);
+
+/**
+ * @brief voyager_bootloader_hal_op_complete Signals that the flash erase or write that the HAL started
+ * asynchronously has finished
+ * @param result VOYAGER_ERROR_NONE if the operation succeeded, otherwise an error code
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ *
+ * @note may be called from an interrupt, including from within the HAL function that started the operation
+ * @note the bootloader does not process further packets while the operation is in flight, but packets
+ * keep being received into the queue
+ */
+voyager_error_E voyager_bootloader_hal_op_complete(const voyager_error_E result);
+
 /**
  * @brief voyager_bootloader_get_state Gets the current state of the bootloader
  * @return The current state of the bootloader
@@ -213,7 +368,10 @@ voyager_error_E voyager_bootloader_nvm_read(const voyager_nvm_key_E key, voyager
  * implemented by the application
  * @note The start and end addresses are provided for convinence, but the
  * bootloader presently assumes only 1 partition and will be equal to the values
- * returned by the NVM_read function.
+ * returned by the NVM_read function, unless flash_sector_info is set in the config,
+ * in which case they are the boundaries of a single sector.
+ * @note May return VOYAGER_ERROR_BUSY after starting the erase to run it in the
+ * background, and must then call voyager_bootloader_hal_op_complete once it finishes.
  */
 voyager_error_E voyager_bootloader_hal_erase_flash(const voyager_bootloader_addr_size_t start_address,
                                                    const voyager_bootloader_addr_size_t end_address);
@@ -228,6 +386,9 @@ voyager_error_E voyager_bootloader_hal_erase_flash(const voyager_bootloader_addr
  *
  * @note This function is called by the bootloader and is required to be
  * implemented by the application
+ * @note May return VOYAGER_ERROR_BUSY after starting the write to run it in the
+ * background, and must then call voyager_bootloader_hal_op_complete once it finishes.
+ * The data stays valid until then, so it can be programmed directly (e.g. by DMA).
  */
 voyager_error_E voyager_bootloader_hal_write_flash(const voyager_bootloader_addr_size_t address, void const *const data,
                                                    size_t const length);
@@ -239,7 +400,9 @@ voyager_error_E voyager_bootloader_hal_write_flash(const voyager_bootloader_addr
  * @param data The buffer to store the read data in
  * @param length The length of the data to read from the flash memory
  * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
- * @note This function is called by the bootloader to verify the flash memory. The address is in one-byte increments.
+ * @note This function is called by the bootloader to verify the flash memory, in chunks of up to
+ * VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE bytes, and to copy the current application when applying a delta update, in
+ * chunks of up to VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE bytes.
  */
 voyager_error_E voyager_bootloader_hal_read_flash(const voyager_bootloader_addr_size_t address, void *const data,
                                                   size_t const length);
@@ -56,4 +56,75 @@
 // or the wrong size
 #endif
 
+#ifndef VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE
+// Number of bytes requested from voyager_bootloader_hal_read_flash per call when
+// verifying the application. Defaults to 64 bytes of module-owned RAM.
+#define VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE 64U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE
+// Number of bytes of the fill value passed to voyager_bootloader_hal_write_flash per call
+// when processing a FILL message. Defaults to 32 bytes of module-owned RAM.
+#define VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE 32U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE
+// Number of bytes copied per flash read and write when a delta update copies from the
+// current application, or installs the staged application over it. Defaults to 32 bytes
+// of module-owned RAM.
+#define VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE 32U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_LZ_WINDOW_BITS
+// log2 of the history window used to decompress DATA payloads when the host starts a
+// compressed DFU, between 4 and 12. The window is module-owned RAM of 2^bits bytes.
+// Defaults to 0, which compiles decompression out and rejects compressed transfers.
+#define VOYAGER_BOOTLOADER_LZ_WINDOW_BITS 0U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_CRC_SLICES
+// Number of bytes the built-in CRC engine consumes per table lookup round. Valid
+// values are 1 (byte-wise, 1 KiB table in flash), 4 (adds 3 KiB of RAM tables) and
+// 8 (adds 7 KiB of RAM tables). Defaults to 1.
+#define VOYAGER_BOOTLOADER_CRC_SLICES 1
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH
+// Number of received packets that can be queued by voyager_bootloader_process_receieved_packet
+// before voyager_bootloader_run drains them. Must be a power of two no larger than 128.
+// Each slot costs VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE bytes of RAM. Defaults to 1.
+#define VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH 1U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE
+// Size in bytes of the RAM buffer used to coalesce DFU payloads into whole, aligned flash
+// pages before calling voyager_bootloader_hal_write_flash (see the coalesce_flash_writes
+// config option). Should match the program granularity of the flash. 0 compiles the
+// buffer out. Defaults to 0.
+#define VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE 0U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE
+// Value every byte of the flash reads as after an erase, usually 0xFF or 0x00. Used to skip
+// writing runs of this value when skip_erased_writes is enabled. Defaults to 0xFF.
+#define VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE 0xFFU
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_ERASED_SKIP_MIN_RUN
+// Shortest run of VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE inside a write that is skipped. Shorter
+// runs are written along with the data around them rather than splitting the write. A write made
+// up entirely of the erased value is always skipped. Defaults to 16.
+#define VOYAGER_BOOTLOADER_ERASED_SKIP_MIN_RUN 16U
+#endif
+
+#ifndef VOYAGER_BOOTLOADER_MEMORY_BARRIER
+// Full memory barrier used to publish receive queue slots between
+// voyager_bootloader_process_receieved_packet (e.g. called from an interrupt) and
+// voyager_bootloader_run (e.g. called from the main loop). On a single core MCU a
+// compiler barrier is sufficient. Defaults to the GCC/Clang atomic fence builtin.
+#if defined(__GNUC__)
+#define VOYAGER_BOOTLOADER_MEMORY_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+#endif
+
 #endif /* _VOYAGER_CFG_H */
\ No newline at end of file
@@ -21,9 +21,113 @@
 #endif  // VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE < 8
 #endif  // VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE
 
+#if VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE < 1
+#error "The VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE macro must be >= 1."
+#endif  // VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE < 1
+
+#if VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE < 1
+#error "The VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE macro must be >= 1."
+#endif  // VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE < 1
+
+#if VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE < 1
+#error "The VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE macro must be >= 1."
+#endif  // VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE < 1
+
+#if (VOYAGER_BOOTLOADER_LZ_WINDOW_BITS != 0) && \
+    ((VOYAGER_BOOTLOADER_LZ_WINDOW_BITS < 4) || (VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 12))
+#error "The VOYAGER_BOOTLOADER_LZ_WINDOW_BITS macro must be 0 or between 4 and 12."
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS
+
+#if (VOYAGER_BOOTLOADER_CRC_SLICES != 1) && (VOYAGER_BOOTLOADER_CRC_SLICES != 4) && (VOYAGER_BOOTLOADER_CRC_SLICES != 8)
+#error "The VOYAGER_BOOTLOADER_CRC_SLICES macro must be 1, 4 or 8."
+#endif  // VOYAGER_BOOTLOADER_CRC_SLICES
+
+#if (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH < 1) || (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH > 128) || \
+    ((VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH & (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH - 1)) != 0)
+#error "The VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH macro must be a power of two between 1 and 128."
+#endif  // VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH
+
+#ifndef VOYAGER_BOOTLOADER_MEMORY_BARRIER
+#error "The VOYAGER_BOOTLOADER_MEMORY_BARRIER() macro must be defined for this compiler."
+#endif  // VOYAGER_BOOTLOADER_MEMORY_BARRIER
+
 /// @brief The size of the ACK message
 #define VOYAGER_DFU_ACK_MESSAGE_SIZE 8U
 
+/// @brief The size of a START message that does not negotiate any options
+#define VOYAGER_DFU_START_MESSAGE_SIZE 8U
+/// @brief Index of the optional byte in the START message requesting a sliding window size
+#define VOYAGER_DFU_START_WINDOW_INDEX 8U
+/// @brief Index of the optional byte in the START message requesting a batched ACK interval
+#define VOYAGER_DFU_START_ACK_INTERVAL_INDEX 9U
+/// @brief Index of the optional byte in the START message carrying the transfer flags
+#define VOYAGER_DFU_START_FLAGS_INDEX 10U
+/// @brief Index of the optional byte in the START message carrying log2 of the compression window the host used
+#define VOYAGER_DFU_START_LZ_WINDOW_BITS_INDEX 11U
+/// @brief Index of the 4 bytes in a delta START message carrying the CRC of the application the patch applies to
+#define VOYAGER_DFU_START_BASE_CRC_INDEX 12U
+/// @brief The size of a START message requesting a delta update
+#define VOYAGER_DFU_DELTA_START_MESSAGE_SIZE 16U
+/// @brief Transfer flag announcing that DATA payloads carry a compressed stream of the application
+#define VOYAGER_DFU_START_FLAG_COMPRESSED 0x01U
+/// @brief Transfer flag announcing that DATA payloads carry a patch against the current application
+#define VOYAGER_DFU_START_FLAG_DELTA 0x02U
+/// @brief Transfer flag asking to resume the DFU from the checkpoint stored in NVM
+#define VOYAGER_DFU_START_FLAG_RESUME 0x04U
+/// @brief The size of a QUERY message: ID, 3 byte app size and app CRC, as in the START message of the DFU to look up
+#define VOYAGER_DFU_QUERY_MESSAGE_SIZE 8U
+/// @brief Index of the byte in the START ACK message carrying the granted sliding window size
+#define VOYAGER_DFU_ACK_WINDOW_INDEX 6U
+/// @brief Index of the byte in the START ACK message carrying the granted batched ACK interval
+#define VOYAGER_DFU_ACK_INTERVAL_INDEX 7U
+/// @brief Index of the byte in a batched DATA ACK message carrying the sequence number of the last packet in the batch
+#define VOYAGER_DFU_ACK_SEQUENCE_INDEX 6U
+/// @brief Index of the byte in a batched DATA ACK message carrying the number of packets in the batch
+#define VOYAGER_DFU_ACK_COUNT_INDEX 7U
+/// @brief The size of a FILL message: ID, sequence number, 3 byte fill length and fill value
+#define VOYAGER_DFU_FILL_MESSAGE_SIZE 6U
+
+/// @brief Smallest compression window, in log2 bytes, a host may use
+#define VOYAGER_LZ_MIN_WINDOW_BITS 4U
+/// @brief Length of the shortest match in a compressed stream, encoded as a length of 0
+#define VOYAGER_LZ_MIN_MATCH_LENGTH 3U
+/// @brief Number of bits of a match token holding the match length, the remaining 12 bits hold the offset
+#define VOYAGER_LZ_LENGTH_BITS 4U
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+/// @brief Size of the history window compressed DATA payloads are decompressed through
+#define VOYAGER_LZ_WINDOW_SIZE (1U << VOYAGER_BOOTLOADER_LZ_WINDOW_BITS)
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+
+/// @brief Patch op copying a run of the current application: op, 3 byte source offset, 3 byte length
+#define VOYAGER_DELTA_OP_COPY 0x01U
+/// @brief Patch op inserting new bytes: op, 3 byte length, then the bytes themselves
+#define VOYAGER_DELTA_OP_INSERT 0x02U
+/// @brief Size of the header of a COPY op
+#define VOYAGER_DELTA_COPY_HEADER_SIZE 7U
+/// @brief Size of the header of an INSERT op
+#define VOYAGER_DELTA_INSERT_HEADER_SIZE 4U
+
+/// @brief Number of NVM keys, starting from 0, whose values are shadowed in RAM
+#define VOYAGER_NVM_CACHE_SIZE (VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC + 1)
+
+/// @brief States of the flash operation the HAL may run asynchronously
+typedef enum {
+    /// @brief No flash operation is in flight
+    VOYAGER_FLASH_OP_IDLE = 0,
+    /// @brief The HAL is running a flash operation in the background
+    VOYAGER_FLASH_OP_BUSY,
+    /// @brief The HAL has completed the flash operation, but the bootloader has not consumed the result yet
+    VOYAGER_FLASH_OP_COMPLETE,
+} voyager_flash_op_state_E;
+
+/// @brief A single slot of the receive queue
+typedef struct {
+    /// @brief Stores the received message
+    uint8_t buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE];
+    /// @brief Stores the size of the received message
+    size_t size;
+} voyager_rx_slot_t;
+
 /// @brief Module data of the voyager bootloader
 typedef struct {
     /// @brief Pointer to the bootloader configuration struct
@@ -39,14 +143,23 @@ typedef struct {
     /// @brief Stores whether the bootloader received a valid DFU start request
     bool valid_dfu_start_request_received;
 
-    /// @brief Stores the last received message in a private buffer
-    uint8_t message_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE];
-    /// @brief Stores the size of the last received message
-    uint32_t packet_size;
-    /// @brief Stores whether there is pending data to be processed
-    bool pending_data;
-    /// @brief Stores whether the bootloader saw a packet overrun
-    bool packet_overrun;
+    /// @brief Queue of received messages waiting to be processed
+    /// @note The queue is single-producer/single-consumer: only voyager_bootloader_process_receieved_packet
+    /// writes rx_write_index and rx_overrun_count, and only voyager_bootloader_run writes rx_read_index and
+    /// rx_overrun_acknowledged, so neither side needs a critical section
+    voyager_rx_slot_t rx_queue[VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH];
+    /// @brief Free-running count of messages taken off the receive queue
+    volatile uint8_t rx_read_index;
+    /// @brief Free-running count of messages placed on the receive queue
+    volatile uint8_t rx_write_index;
+    /// @brief Free-running count of packets dropped because the receive queue was full. It stops 255 drops ahead of
+    /// rx_overrun_acknowledged rather than wrapping back to it, so it stays a single byte that is read and written atomically
+    volatile uint8_t rx_overrun_count;
+    /// @brief Value of rx_overrun_count when the last overrun was handled
+    volatile uint8_t rx_overrun_acknowledged;
+    /// @brief Whether the producer holds the buffer lent by voyager_bootloader_acquire_rx_buffer, only the producer
+    /// writes it
+    bool rx_buffer_acquired;
 
     /// @brief Stores the size of the application in a RAM cache to prevent multiple reads from NVM
     size_t app_size_cached;
@@ -59,8 +172,150 @@ typedef struct {
 
     /// @brief Stores the current sequence number of the DFU data packets
     uint8_t dfu_sequence_number;
+    /// @brief Number of unacknowledged DATA packets the host may have in flight, 1 for stop-and-wait
+    uint8_t dfu_window_size;
+    /// @brief Stores whether the current gap in the sequence has already been reported to the host
+    bool dfu_out_of_sequence_nacked;
+    /// @brief Number of DATA packets acknowledged by a single cumulative ACK, 1 to ACK every packet
+    uint8_t dfu_ack_interval;
+    /// @brief Number of DATA packets accepted since the last cumulative ACK
+    uint8_t dfu_batch_count;
+    /// @brief CRC of the sequence numbers and payloads of the DATA packets accepted since the last cumulative ACK
+    voyager_bootloader_app_crc_t dfu_batch_crc;
     /// @brief Tracks the number of bytes written to flash in DFU mode
     voyager_bootloader_app_size_t bytes_written;
+
+    /// @brief Stores the expected CRC of the application received in the DFU start packet
+    voyager_bootloader_app_crc_t app_crc_cached;
+    /// @brief Running CRC of the application accumulated as DFU payloads are written
+    voyager_bootloader_app_crc_t dfu_running_crc;
+    /// @brief Stores whether the application received over DFU matched the expected CRC
+    bool app_verified_during_dfu;
+
+    /// @brief Stores whether a flash verification is in progress across calls to voyager_bootloader_run
+    bool verify_in_progress;
+    /// @brief Start address of the application being verified
+    voyager_bootloader_addr_size_t verify_app_start_address;
+    /// @brief Size of the application being verified
+    voyager_bootloader_app_size_t verify_app_size;
+    /// @brief Expected CRC of the application being verified
+    voyager_bootloader_app_crc_t verify_app_crc;
+    /// @brief Number of application bytes verified so far
+    voyager_bootloader_app_size_t verify_offset;
+    /// @brief Partial CRC of the application bytes verified so far
+    voyager_bootloader_app_crc_t verify_crc;
+
+    /// @brief RAM shadow of the NVM keys, indexed by key, so that repeated reads do not go to NVM
+    voyager_bootloader_nvm_data_t nvm_cache[VOYAGER_NVM_CACHE_SIZE];
+    /// @brief Bitmask of the keys in nvm_cache that hold the value currently in NVM
+    uint32_t nvm_cache_valid;
+
+    /// @brief With lazy erase, the address up to which the partition has been erased during this DFU
+    voyager_bootloader_addr_size_t erased_until_address;
+    /// @brief Address up to which the HAL has finished writing during this DFU
+    voyager_bootloader_addr_size_t programmed_until_address;
+    /// @brief Address up to which writes have finished and been accumulated into the running CRC during this DFU
+    voyager_bootloader_addr_size_t committed_until_address;
+    /// @brief End of the flash the current DFU writes to, which background erase stops at
+    voyager_bootloader_addr_size_t erase_ahead_end_address;
+
+    /// @brief State of the flash operation that may be running asynchronously, set from the HAL completion interrupt
+    volatile uint8_t flash_op_state;
+    /// @brief Result of the flash operation, valid once flash_op_state is VOYAGER_FLASH_OP_COMPLETE
+    volatile voyager_error_E flash_op_result;
+    /// @brief Whether the flash operation in flight is an erase (true) or a write (false)
+    bool flash_op_is_erase;
+    /// @brief Address that erased_until_address or programmed_until_address advances to once the operation succeeds
+    voyager_bootloader_addr_size_t flash_op_end_address;
+    /// @brief Number of bytes of the current DFU payload copied into the page buffer before an asynchronous write
+    size_t flash_payload_offset;
+    /// @brief Number of bytes of the current FILL message written so far
+    voyager_bootloader_app_size_t fill_bytes_written;
+    /// @brief Buffer holding the fill value of the current FILL message, written to flash a chunk at a time
+    uint8_t fill_buffer[VOYAGER_BOOTLOADER_FILL_CHUNK_SIZE];
+
+#if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+    /// @brief Buffer that DFU payloads are coalesced into before being written to flash a page at a time
+    uint8_t flash_page_buffer[VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE];
+    /// @brief Flash address of the first byte in flash_page_buffer
+    voyager_bootloader_addr_size_t flash_page_address;
+    /// @brief Number of bytes waiting in flash_page_buffer
+    size_t flash_page_fill;
+#endif  // VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+
+    /// @brief Whether the DATA payloads of the current DFU carry a compressed stream rather than the application itself
+    bool dfu_compressed;
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+    /// @brief The most recently decompressed bytes, which matches copy from and which are written to flash from
+    uint8_t lz_window[VOYAGER_LZ_WINDOW_SIZE];
+    /// @brief Number of bytes decompressed during this DFU
+    voyager_bootloader_app_size_t lz_output_count;
+    /// @brief Number of decompressed bytes handed to flash, the rest of the window up to lz_output_count is pending
+    voyager_bootloader_app_size_t lz_flushed_count;
+    /// @brief Number of bytes of the current DATA payload consumed by the decompressor
+    size_t lz_input_offset;
+    /// @brief Flags byte of the current group of eight items, a set bit is a literal and a clear bit a match
+    uint8_t lz_flags;
+    /// @brief Number of items of the current group still to be decoded
+    uint8_t lz_flags_remaining;
+    /// @brief Whether the first byte of a match token has been consumed, a token may straddle two DATA payloads
+    bool lz_have_token_high;
+    /// @brief First byte of the match token being decoded
+    uint8_t lz_token_high;
+    /// @brief Distance back into the window of the match being copied
+    uint16_t lz_match_offset;
+    /// @brief Number of bytes of the match being copied still to be output
+    uint8_t lz_match_remaining;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+
+    /// @brief Whether the DATA payloads of the current DFU carry a patch against the current application
+    bool dfu_delta;
+    /// @brief Start address of the application the patch copies from
+    voyager_bootloader_addr_size_t delta_base_address;
+    /// @brief Size of the application the patch copies from
+    voyager_bootloader_app_size_t delta_base_size;
+    /// @brief Header of the patch op being received, which may straddle two DATA payloads
+    uint8_t delta_header[VOYAGER_DELTA_COPY_HEADER_SIZE];
+    /// @brief Number of bytes of delta_header received so far
+    uint8_t delta_header_fill;
+    /// @brief The patch op being applied
+    uint8_t delta_op;
+    /// @brief Number of bytes the patch op still has to output
+    voyager_bootloader_app_size_t delta_op_remaining;
+    /// @brief Offset into the current application of the next byte a COPY op copies
+    voyager_bootloader_app_size_t delta_source_offset;
+    /// @brief Number of bytes of the current DATA payload consumed by the patcher
+    size_t delta_input_offset;
+    /// @brief Number of bytes of the new application staged during this DFU
+    voyager_bootloader_app_size_t delta_output_count;
+    /// @brief Chunk read from flash by a COPY op, or while installing the staged application
+    uint8_t delta_copy_buffer[VOYAGER_BOOTLOADER_DELTA_COPY_CHUNK_SIZE];
+    /// @brief Whether delta_copy_buffer holds the chunk being written, so an asynchronous write is not read over
+    bool delta_copy_loaded;
+    /// @brief Whether the staged application has been verified and is being copied over the current one
+    bool delta_installing;
+    /// @brief Number of bytes of the staged application copied over the current one
+    voyager_bootloader_app_size_t delta_install_offset;
+
+    /// @brief Whether checkpoints of the current DFU are stored in NVM
+    bool dfu_checkpointing;
+    /// @brief Identifies the current DFU in the stored checkpoint
+    uint32_t dfu_checkpoint_session;
+    /// @brief Address in flash at which the next checkpoint is taken
+    voyager_bootloader_addr_size_t next_checkpoint_address;
+    /// @brief Whether a checkpoint has been taken that is not yet stored in NVM
+    bool checkpoint_pending;
+    /// @brief Address up to which the application was in flash when the pending checkpoint was taken
+    voyager_bootloader_addr_size_t checkpoint_address;
+    /// @brief Running CRC of the application bytes in flash when the pending checkpoint was taken
+    voyager_bootloader_app_crc_t checkpoint_crc;
+    /// @brief Number of application bytes the DFU being started resumes after, 0 for a fresh DFU
+    voyager_bootloader_app_size_t dfu_resume_offset;
+    /// @brief Running CRC of the application bytes the DFU being started resumes after
+    voyager_bootloader_app_crc_t dfu_resume_crc;
+
+    /// @brief Scratch buffer that flash is read into when verifying the application
+    uint8_t flash_read_buffer[VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE];
 } voyager_data_t;
 
 /*! \cond PRIVATE */
@@ -74,12 +329,26 @@ typedef struct {
         struct {
             uint32_t app_size;  // NOTE: only 3 bytes wide!
             uint32_t app_crc;
+            uint8_t window_size;   // 0 if not requested
+            uint8_t ack_interval;  // 0 if not requested
+            uint8_t flags;           // 0 if not requested
+            uint8_t lz_window_bits;  // 0 if not requested
+            uint32_t base_crc;       // only valid for delta updates
         } start_packet_data;
         struct {
             uint8_t sequence_number;
             uint8_t *payload;
             size_t payload_size;
         } data_packet_data;
+        struct {
+            uint8_t sequence_number;
+            uint32_t fill_length;  // NOTE: only 3 bytes wide!
+            uint8_t fill_value;
+        } fill_packet_data;
+        struct {
+            uint32_t app_size;  // NOTE: only 3 bytes wide!
+            uint32_t app_crc;
+        } query_packet_data;
     } message_payload;
 } voyager_message_t;
 /*! \endcond */
@@ -94,6 +363,10 @@ typedef enum {
     VOYAGER_MESSAGE_ID_ACK,
     /// @brief DFU Data message ID
     VOYAGER_MESSAGE_ID_DATA,
+    /// @brief DFU Fill message ID, standing in for a DATA packet whose payload is a run of a single byte value
+    VOYAGER_MESSAGE_ID_FILL,
+    /// @brief DFU Query message ID, asking how much of a DFU can be resumed from the stored checkpoint
+    VOYAGER_MESSAGE_ID_QUERY,
 } voyager_message_id_E;
 
 /**
@@ -111,6 +384,15 @@ voyager_bootloader_app_crc_t voyager_private_calculate_crc(const void *buffer, c
  */
 void voyager_private_calculate_crc_stream(const uint8_t byte, voyager_bootloader_app_crc_t *const crc);
 
+/**
+ * @brief voyager_private_calculate_crc_block Further calculates the CRC over a block of bytes
+ * @param buffer The bytes to add to the CRC
+ * @param length The number of bytes in the buffer
+ * @param crc The CRC to add the bytes to
+ * @note Produces the same result as calling voyager_private_calculate_crc_stream for every byte in the buffer
+ */
+void voyager_private_calculate_crc_block(const void *buffer, const size_t length, voyager_bootloader_app_crc_t *const crc);
+
 /**
  * @brief voyager_private_get_desired_state Gets the desired state of the
  * bootloader
@@ -162,6 +444,61 @@ voyager_error_E voyager_private_generate_ack_message(const voyager_dfu_error_E e
  */
 voyager_message_t voyager_private_unpack_message(uint8_t *const message_buffer, size_t const message_size);
 
+/**
+ * @brief voyager_private_nvm_read Reads a value from a given key, from the RAM shadow when it holds the key
+ * @param key The key to read
+ * @param data The data read from NVM
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_nvm_read(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t *const data);
+
+/**
+ * @brief voyager_private_nvm_write Writes a value to a given key in NVM and updates the RAM shadow
+ * @param key The key to write
+ * @param data The data to write to NVM
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_nvm_write(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t const *const data);
+
+/**
+ * @brief voyager_private_nvm_invalidate_cache Discards the RAM shadow so the next read of every key goes to NVM
+ */
+void voyager_private_nvm_invalidate_cache(void);
+
+/**
+ * @brief voyager_private_rx_queue_count Gets the number of received messages waiting to be processed
+ * @return The number of queued messages
+ */
+size_t voyager_private_rx_queue_count(void);
+
+/**
+ * @brief voyager_private_rx_queue_peek Gets the oldest received message without removing it from the queue
+ * @return Pointer to the oldest queued slot, or NULL if the queue is empty
+ */
+voyager_rx_slot_t *voyager_private_rx_queue_peek(void);
+
+/**
+ * @brief voyager_private_rx_queue_pop Removes the oldest received message from the queue
+ * @note Does nothing if the queue is empty
+ */
+void voyager_private_rx_queue_pop(void);
+
+/**
+ * @brief voyager_private_rx_queue_flush Discards all queued messages
+ */
+void voyager_private_rx_queue_flush(void);
+
+/**
+ * @brief voyager_private_rx_queue_overrun Gets whether a packet was dropped since the last overrun was handled
+ * @return true if the receive queue overran
+ */
+bool voyager_private_rx_queue_overrun(void);
+
+/**
+ * @brief voyager_private_rx_queue_clear_overrun Marks all overruns seen so far as handled
+ */
+void voyager_private_rx_queue_clear_overrun(void);
+
 /**
  * @brief voyager_private_init_dfu Initializes the DFU bootloader by erasing
  * flash
@@ -179,21 +516,284 @@ voyager_error_E voyager_private_init_dfu(void);
 voyager_error_E voyager_private_process_start_packet(const voyager_message_t *const message);
 
 /**
- * @brief voyager_private_process_data_packet Processes a data packet
+ * @brief voyager_private_process_delta_start Checks that a delta update can be applied to the current application
+ * @param message The start message
+ * @param start_error Set to the error the START is NACKed with if the update cannot be applied
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_process_delta_start(const voyager_message_t *const message,
+                                                   voyager_dfu_error_E *const start_error);
+
+/**
+ * @brief voyager_private_process_resume_start Looks up the checkpoint a resuming DFU continues from
+ * @param message The start message
+ * @param start_error Set to the error the START is NACKed with if there is no checkpoint of the application
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_process_resume_start(const voyager_message_t *const message,
+                                                    voyager_dfu_error_E *const start_error);
+
+/**
+ * @brief voyager_private_process_query_packet Processes a query packet, ACKing it with the offset the DFU it describes
+ * can be resumed from
+ * @param message The message to process
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note This function populates the acknowledgement message buffer, but does
+ * NOT send an ack message
+ */
+voyager_error_E voyager_private_process_query_packet(const voyager_message_t *const message);
+
+/**
+ * @brief voyager_private_find_checkpoint Looks up the stored checkpoint a DFU can be resumed from
+ * @param app_size The size of the application in the start packet of the DFU
+ * @param app_crc The CRC of the application in the start packet of the DFU
+ * @param offset Set to the number of application bytes the DFU can resume after, 0 if it has to start over
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note With lazy erase, a checkpoint that is not at the start of a sector is never resumed from
+ */
+voyager_error_E voyager_private_find_checkpoint(const voyager_bootloader_app_size_t app_size,
+                                                const voyager_bootloader_app_crc_t app_crc,
+                                                voyager_bootloader_app_size_t *const offset);
+
+/**
+ * @brief voyager_private_checkpoint_session Derives the identifier of a DFU stored with its checkpoints
+ * @param app_size The size of the application in the start packet of the DFU
+ * @param app_crc The CRC of the application in the start packet of the DFU
+ * @return The session identifier
+ */
+uint32_t voyager_private_checkpoint_session(const voyager_bootloader_app_size_t app_size,
+                                            const voyager_bootloader_app_crc_t app_crc);
+
+/**
+ * @brief voyager_private_store_checkpoint Stores the pending checkpoint of the current DFU in NVM
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note The stored checkpoint is invalidated first, so a power loss part way through never leaves a mismatched offset and CRC
+ */
+voyager_error_E voyager_private_store_checkpoint(void);
+
+/**
+ * @brief voyager_private_clear_checkpoint Invalidates the checkpoint of the current DFU stored in NVM
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_clear_checkpoint(void);
+
+/**
+ * @brief voyager_private_record_new_image Records the size and CRC of an incoming application in NVM, and invalidates the
+ * verified marker of the current one
+ * @param app_size The size of the incoming application
+ * @param app_crc The CRC of the incoming application
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_record_new_image(const voyager_bootloader_app_size_t app_size,
+                                                 const voyager_bootloader_app_crc_t app_crc);
+
+/**
+ * @brief voyager_private_process_data_packet Processes a DATA or FILL packet
  * @param message The message to process
+ * @param send_ack Set to true if the acknowledgement message buffer should be sent to the host
  * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
  * @note This function populates the acknowledgement message buffer, but does
  * NOT send an ack message
  */
-voyager_error_E voyager_private_process_data_packet(const voyager_message_t *const message);
+voyager_error_E voyager_private_process_data_packet(const voyager_message_t *const message, bool *const send_ack);
+
+/**
+ * @brief voyager_private_flash_op_pending Checks whether the HAL is still running a flash operation in the background
+ * @return true if a flash operation is in flight, false otherwise
+ */
+bool voyager_private_flash_op_pending(void);
+
+/**
+ * @brief voyager_private_flash_op_poll Consumes the result of a completed asynchronous flash operation, advancing the
+ * erased or programmed address on success
+ * @return VOYAGER_ERROR_NONE if no operation is in flight or it succeeded, VOYAGER_ERROR_BUSY if it is still in flight,
+ * otherwise the error code the operation completed with
+ */
+voyager_error_E voyager_private_flash_op_poll(void);
+
+/**
+ * @brief voyager_private_flash_op_begin Marks a flash operation as in flight before its HAL function is called
+ * @param is_erase true if the operation is an erase, false if it is a write
+ * @param end_address Address that the erased or programmed address advances to once the operation succeeds
+ */
+void voyager_private_flash_op_begin(const bool is_erase, const voyager_bootloader_addr_size_t end_address);
+
+/**
+ * @brief voyager_private_flash_op_started Handles the value returned by the HAL function that started a flash operation
+ * @param hal_result The value returned by the HAL function
+ * @return VOYAGER_ERROR_BUSY if the operation continues in the background, otherwise hal_result
+ */
+voyager_error_E voyager_private_flash_op_started(const voyager_error_E hal_result);
+
+/**
+ * @brief voyager_private_erase_before_write Erases the sectors a write is about to touch, if they have not been erased
+ * during this DFU yet. Does nothing unless lazy erase is enabled
+ * @param address The flash address of the write
+ * @param length The number of bytes in the write
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_erase_before_write(const voyager_bootloader_addr_size_t address, const size_t length);
+
+/**
+ * @brief voyager_private_erase_ahead Starts erasing the next sector the current DFU will write to, if background erase is
+ * enabled and no flash operation is running
+ * @return VOYAGER_ERROR_NONE if successful or the erase continues in the background, otherwise an error code
+ */
+voyager_error_E voyager_private_erase_ahead(void);
+
+/**
+ * @brief voyager_private_next_write_run Splits the data of a write into runs that are written and runs of the erased value
+ * that are skipped
+ * @param data The data left to write
+ * @param length The number of bytes left to write, must be greater than 0
+ * @param min_skip_run The shortest run of the erased value that is skipped, unless it makes up the rest of the data
+ * @param erased Set to true if the run can be skipped, false if it must be written
+ * @return The number of bytes in the run at the start of data
+ */
+size_t voyager_private_next_write_run(const uint8_t *const data, const size_t length, const size_t min_skip_run,
+                                      bool *const erased);
+
+/**
+ * @brief voyager_private_write_flash Writes received application data to flash, and accumulates it into the running DFU
+ * CRC if enabled. Returns VOYAGER_ERROR_BUSY while the HAL is busy, and must be called again with the same arguments
+ * until it completes
+ * @param address The flash address to write to
+ * @param data The data to write
+ * @param length The number of bytes to write
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_write_flash(const voyager_bootloader_addr_size_t address, const uint8_t *const data,
+                                            const size_t length);
+
+/**
+ * @brief voyager_private_write_dfu_payload Writes a DFU payload to flash, either directly or through the page buffer
+ * @param address The flash address to write to, directly following the previous payload
+ * @param data The payload to write
+ * @param length The number of bytes in the payload
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_write_dfu_payload(const voyager_bootloader_addr_size_t address, const uint8_t *const data,
+                                                  const size_t length);
+
+/**
+ * @brief voyager_private_flush_flash_page Writes any payload bytes waiting in the page buffer to flash
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_flush_flash_page(void);
+
+/**
+ * @brief voyager_private_write_fill Writes the run of the fill value described by a FILL message to flash
+ * @param address The flash address to start writing at
+ * @param fill_length The number of bytes to fill
+ * @param fill_value The value to fill with
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_write_fill(const voyager_bootloader_addr_size_t address,
+                                           const voyager_bootloader_app_size_t fill_length, const uint8_t fill_value);
+
+/**
+ * @brief voyager_private_write_compressed_payload Decompresses a compressed DATA payload and writes the output to flash
+ * @param start_address The flash address of the start of the application
+ * @param data The compressed payload
+ * @param length The size of the compressed payload
+ * @param output Set to the number of application bytes the payload decompressed to once it is fully in flash
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note A payload that does not decompress sets dfu_error and returns VOYAGER_ERROR_INVALID_ARGUMENT
+ */
+voyager_error_E voyager_private_write_compressed_payload(const voyager_bootloader_addr_size_t start_address,
+                                                         const uint8_t *const data, const size_t length,
+                                                         voyager_bootloader_app_size_t *const output);
+
+/**
+ * @brief voyager_private_write_patch_payload Applies a delta update patch payload, writing the new application it
+ * reconstructs to the staging area
+ * @param data The patch payload
+ * @param length The size of the patch payload
+ * @param output Set to the number of application bytes the payload reconstructed once they are fully in flash
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note A malformed patch sets dfu_error and returns VOYAGER_ERROR_INVALID_ARGUMENT
+ */
+voyager_error_E voyager_private_write_patch_payload(const uint8_t *const data, const size_t length,
+                                                    voyager_bootloader_app_size_t *const output);
+
+/**
+ * @brief voyager_private_install_staged_image Checks the CRC of the application reconstructed in the staging area, then
+ * records it in NVM and copies it over the current application
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note A staged application that does not match the expected CRC sets dfu_error, leaves the current application alone
+ * and returns VOYAGER_ERROR_INVALID_ARGUMENT
+ */
+voyager_error_E voyager_private_install_staged_image(void);
+
+/**
+ * @brief voyager_private_flush_decompressed Writes the decompressed bytes waiting in the window to flash
+ * @param start_address The flash address of the start of the application
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_flush_decompressed(const voyager_bootloader_addr_size_t start_address);
+
+/**
+ * @brief voyager_private_generate_data_ack Generates the ACK for a DATA or FILL packet that was written to flash
+ * @param sequence_number The sequence number of the packet that was written
+ * @param send_ack Set to false if the packet is held back for a later cumulative ACK
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note In batched mode the ACK is only generated for every dfu_ack_interval packets and for the
+ * last packet of the application. It carries the CRC of the whole batch, the sequence number of the
+ * last packet and the number of packets in the batch
+ */
+voyager_error_E voyager_private_generate_data_ack(const uint8_t sequence_number, bool *const send_ack);
+
+/**
+ * @brief voyager_private_accumulate_dfu_crc Adds a written DFU payload to the running application CRC
+ * @param address The flash address the payload was written to
+ * @param payload The payload that was written
+ * @param length The length of the payload
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note Reads the payload back from flash when readback_flash_during_dfu is set
+ */
+voyager_error_E voyager_private_accumulate_dfu_crc(const voyager_bootloader_addr_size_t address, const uint8_t *const payload,
+                                                   const size_t length);
 
 /**
  * @brief voyager_private_verify_flash Verifies the flash memory of the MCU
  * @param result The result of the flash verification
  * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note Runs the whole verification in one call
  */
 voyager_error_E voyager_private_verify_flash(bool *const result);
 
+/**
+ * @brief voyager_private_verify_flash_start Starts a resumable verification of the flash memory of the MCU
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_verify_flash_start(void);
+
+/**
+ * @brief voyager_private_verify_flash_step Continues a verification started by voyager_private_verify_flash_start
+ * @param max_bytes The maximum number of bytes to verify in this step, 0 for no limit
+ * @param complete Set to whether the verification has finished
+ * @param result The result of the flash verification, only valid once complete
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_verify_flash_step(const voyager_bootloader_app_size_t max_bytes, bool *const complete,
+                                                  bool *const result);
+
+/**
+ * @brief voyager_private_verify_app Verifies the application according to the configured verify policy
+ * @param complete Set to whether the verification has finished
+ * @param result The result of the verification, only valid once complete
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ * @note Only reads the application flash when the verify policy requires it, and at most verify_bytes_per_run bytes
+ * of it per call
+ */
+voyager_error_E voyager_private_verify_app(bool *const complete, bool *const result);
+
+/**
+ * @brief voyager_private_record_app_verified Records in NVM that the current application image has been verified
+ * @return VOYAGER_ERROR_NONE if successful, otherwise an error code
+ */
+voyager_error_E voyager_private_record_app_verified(void);
+
 /**
  * @brief voyager_private_pack_crc_into_buffer Packs a CRC into a buffer
  * @param buffer The buffer to pack the CRC into
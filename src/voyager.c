@@ -25,15 +25,67 @@ voyager_error_E voyager_bootloader_init(voyager_bootloader_config_t const *const
         voyager_data.state = VOYAGER_STATE_IDLE;
         voyager_data.request = VOYAGER_REQUEST_KEEP_IDLE;
         voyager_data.app_failed_crc_check = false;
-        memset(voyager_data.message_buffer, 0, sizeof(voyager_data.message_buffer));
-        voyager_data.packet_size = 0;
-        voyager_data.pending_data = false;
-        voyager_data.packet_overrun = false;
+        memset(voyager_data.rx_queue, 0, sizeof(voyager_data.rx_queue));
+        voyager_data.rx_read_index = 0U;
+        voyager_data.rx_write_index = 0U;
+        voyager_data.rx_overrun_count = 0U;
+        voyager_data.rx_overrun_acknowledged = 0U;
+        voyager_data.rx_buffer_acquired = false;
         voyager_data.valid_dfu_start_request_received = false;
         voyager_data.dfu_sequence_number = 0;
+        voyager_data.dfu_window_size = 1U;
+        voyager_data.dfu_out_of_sequence_nacked = false;
+        voyager_data.dfu_ack_interval = 1U;
+        voyager_data.dfu_batch_count = 0U;
+        voyager_data.dfu_batch_crc = 0xffffffff;
         voyager_data.bytes_written = 0;
         voyager_data.dfu_error = VOYAGER_DFU_ERROR_NONE;
         voyager_data.app_size_cached = 0U;
+        voyager_data.app_crc_cached = 0U;
+        voyager_data.dfu_running_crc = 0xffffffff;
+        voyager_data.app_verified_during_dfu = false;
+        voyager_data.verify_in_progress = false;
+        voyager_data.erased_until_address = 0U;
+        voyager_data.programmed_until_address = 0U;
+        voyager_data.committed_until_address = 0U;
+        voyager_data.erase_ahead_end_address = 0U;
+        voyager_data.flash_op_state = VOYAGER_FLASH_OP_IDLE;
+        voyager_data.flash_op_result = VOYAGER_ERROR_NONE;
+        voyager_data.flash_op_is_erase = false;
+        voyager_data.flash_op_end_address = 0U;
+        voyager_data.flash_payload_offset = 0U;
+        voyager_data.fill_bytes_written = 0U;
+#if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+        voyager_data.flash_page_fill = 0U;
+#endif  // VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+        voyager_data.dfu_compressed = false;
+        voyager_data.dfu_delta = false;
+        voyager_data.delta_base_address = 0U;
+        voyager_data.delta_base_size = 0U;
+        voyager_data.delta_header_fill = 0U;
+        voyager_data.delta_op_remaining = 0U;
+        voyager_data.delta_input_offset = 0U;
+        voyager_data.delta_output_count = 0U;
+        voyager_data.delta_copy_loaded = false;
+        voyager_data.delta_installing = false;
+        voyager_data.delta_install_offset = 0U;
+        voyager_data.dfu_checkpointing = false;
+        voyager_data.dfu_checkpoint_session = 0U;
+        voyager_data.next_checkpoint_address = 0U;
+        voyager_data.checkpoint_pending = false;
+        voyager_data.checkpoint_address = 0U;
+        voyager_data.checkpoint_crc = 0xffffffff;
+        voyager_data.dfu_resume_offset = 0U;
+        voyager_data.dfu_resume_crc = 0xffffffff;
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+        voyager_data.lz_output_count = 0U;
+        voyager_data.lz_flushed_count = 0U;
+        voyager_data.lz_input_offset = 0U;
+        voyager_data.lz_flags_remaining = 0U;
+        voyager_data.lz_have_token_high = false;
+        voyager_data.lz_match_remaining = 0U;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+        voyager_private_nvm_invalidate_cache();
         // memset the ack message buffer to 0
         memset(voyager_data.ack_message_buffer, 0, sizeof(voyager_data.ack_message_buffer));
         voyager_data.error_latched = VOYAGER_ERROR_NONE;
@@ -109,9 +161,16 @@ voyager_error_E voyager_private_exit_state(const voyager_bootloader_state_E curr
         } break;
 
         case VOYAGER_STATE_DFU_RECEIVE: {
-            voyager_data.packet_overrun = false;
+            voyager_private_rx_queue_clear_overrun();
+            if (voyager_data.dfu_error != VOYAGER_DFU_ERROR_NONE) {
+                // Packets queued behind a failed transfer are stale
+                voyager_private_rx_queue_flush();
+            }
+        } break;
+        case VOYAGER_STATE_JUMP_TO_APP: {
+            // Abandon any partially completed verification
+            voyager_data.verify_in_progress = false;
         } break;
-        case VOYAGER_STATE_JUMP_TO_APP:
         case VOYAGER_STATE_NOT_INITIALIZED:
         default:
             // do nothing
@@ -136,6 +195,7 @@ voyager_error_E voyager_private_enter_state(const voyager_bootloader_state_E cur
             } break;
             case VOYAGER_STATE_IDLE: {
                 voyager_data.app_size_cached = 0U;
+                voyager_data.app_verified_during_dfu = false;
             }
             case VOYAGER_STATE_JUMP_TO_APP:
             case VOYAGER_STATE_NOT_INITIALIZED:
@@ -157,12 +217,18 @@ voyager_error_E voyager_private_run_state(const voyager_bootloader_state_E state
                 ret = voyager_private_run_idle_state();
             } break;
             case VOYAGER_STATE_JUMP_TO_APP: {
+                bool verification_complete = false;
                 bool flash_verified = false;
-                ret = voyager_private_verify_flash(&flash_verified);
+                ret = voyager_private_verify_app(&verification_complete, &flash_verified);
                 if (ret != VOYAGER_ERROR_NONE) {
                     break;
                 }
 
+                if (verification_complete == false) {
+                    // Continue verifying on the next run
+                    break;
+                }
+
                 if (flash_verified == false) {
                     voyager_data.app_failed_crc_check = true;
                     break;
@@ -170,7 +236,7 @@ voyager_error_E voyager_private_run_state(const voyager_bootloader_state_E state
 
                 // Get the app start address
                 voyager_bootloader_nvm_data_t data;
-                ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+                ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
                 if (ret != VOYAGER_ERROR_NONE) {
                     break;
                 }
@@ -199,17 +265,21 @@ voyager_error_E voyager_private_run_idle_state(void) {
     voyager_data.dfu_error = VOYAGER_DFU_ERROR_NONE;
 
     // If we receive a start packet, we check if the request is ENTER_DFU.
-    // Otherwise, issue an error
-    if (voyager_data.pending_data) {
-        if (voyager_data.packet_overrun) {
-            // generate an ack with an error
+    // Otherwise, issue an error. Packets stay queued until the flash operation of an abandoned DFU has finished
+    voyager_rx_slot_t *const slot = voyager_private_flash_op_pending() ? NULL : voyager_private_rx_queue_peek();
+    if (slot != NULL) {
+        if (voyager_private_rx_queue_overrun()) {
+            // generate an ack with an error and drop everything queued before the overrun
             ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_PACKET_OVERRUN, NULL, voyager_data.ack_message_buffer,
                                                        sizeof(voyager_data.ack_message_buffer));
 
-            voyager_data.packet_overrun = false;
+            // Acknowledge the overrun before flushing, so a packet dropped during the flush is still reported. The flush
+            // frees every slot it drops, so nothing is popped afterwards
+            voyager_private_rx_queue_clear_overrun();
+            voyager_private_rx_queue_flush();
         } else {
             // Unpack the message
-            voyager_message_t message = voyager_private_unpack_message(voyager_data.message_buffer, voyager_data.packet_size);
+            voyager_message_t message = voyager_private_unpack_message(slot->buffer, slot->size);
 
             // If the message is a start packet, we check if the request is set
             // to ENTER_DFU
@@ -217,7 +287,8 @@ voyager_error_E voyager_private_run_idle_state(void) {
                 if (voyager_data.request == VOYAGER_REQUEST_ENTER_DFU) {
                     ret = voyager_private_process_start_packet(&message);
 
-                    if (ret == VOYAGER_ERROR_NONE) {
+                    // A START asking for an unsupported option is NACKed and leaves us idle
+                    if ((ret == VOYAGER_ERROR_NONE) && (voyager_data.dfu_error == VOYAGER_DFU_ERROR_NONE)) {
                         voyager_data.valid_dfu_start_request_received = true;
                     }
                 } else {
@@ -226,7 +297,11 @@ voyager_error_E voyager_private_run_idle_state(void) {
                                                                voyager_data.ack_message_buffer,
                                                                sizeof(voyager_data.ack_message_buffer));
                 }
-            } else if (message.header.message_id == VOYAGER_MESSAGE_ID_DATA) {
+            } else if (message.header.message_id == VOYAGER_MESSAGE_ID_QUERY) {
+                // Only reads NVM, so the host may ask before requesting DFU mode
+                ret = voyager_private_process_query_packet(&message);
+            } else if ((message.header.message_id == VOYAGER_MESSAGE_ID_DATA) ||
+                       (message.header.message_id == VOYAGER_MESSAGE_ID_FILL)) {
                 // Issue an ack with an error
                 ret =
                     voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE, NULL, voyager_data.ack_message_buffer,
@@ -237,12 +312,15 @@ voyager_error_E voyager_private_run_idle_state(void) {
                                                            voyager_data.ack_message_buffer,
                                                            sizeof(voyager_data.ack_message_buffer));
             }
+
+            // Free the slot before the host can answer the ACK with its next packet
+            voyager_private_rx_queue_pop();
         }
+
         // Send the ACK
         if (ret == VOYAGER_ERROR_NONE) {
             ret = voyager_bootloader_send_to_host(voyager_data.ack_message_buffer, sizeof(voyager_data.ack_message_buffer));
         }
-        voyager_data.pending_data = false;
     }
 
     return ret;
@@ -251,19 +329,32 @@ voyager_error_E voyager_private_run_idle_state(void) {
 voyager_error_E voyager_private_run_dfu_receive_state(void) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
     do {
-        if (voyager_data.pending_data) {
-            if (voyager_data.packet_overrun == false) {
+        // Packets received while the HAL is busy stay queued until the flash operation completes
+        if (voyager_private_flash_op_pending()) {
+            break;
+        }
+
+        voyager_rx_slot_t *const slot = voyager_private_rx_queue_peek();
+        if (slot != NULL) {
+            bool send_ack = true;
+            const bool overrun = voyager_private_rx_queue_overrun();
+            if (overrun == false) {
                 // Unpack the message
-                voyager_message_t message = voyager_private_unpack_message(voyager_data.message_buffer, voyager_data.packet_size);
+                voyager_message_t message = voyager_private_unpack_message(slot->buffer, slot->size);
 
-                if (message.header.message_id == VOYAGER_MESSAGE_ID_DATA) {
-                    ret = voyager_private_process_data_packet(&message);
+                if ((message.header.message_id == VOYAGER_MESSAGE_ID_DATA) ||
+                    (message.header.message_id == VOYAGER_MESSAGE_ID_FILL)) {
+                    ret = voyager_private_process_data_packet(&message, &send_ack);
                 } else if (message.header.message_id == VOYAGER_MESSAGE_ID_START) {
                     ret = voyager_private_process_start_packet(&message);
                     if (ret != VOYAGER_ERROR_NONE) {
                         break;
                     }
-                    ret = voyager_private_init_dfu();
+                    if (voyager_data.dfu_error == VOYAGER_DFU_ERROR_NONE) {
+                        ret = voyager_private_init_dfu();
+                    }
+                } else if (message.header.message_id == VOYAGER_MESSAGE_ID_QUERY) {
+                    ret = voyager_private_process_query_packet(&message);
                 } else {
                     // Issue an ack with an error
                     ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_INVALID_MESSAGE_ID, NULL,
@@ -278,14 +369,29 @@ voyager_error_E voyager_private_run_dfu_receive_state(void) {
                     voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_PACKET_OVERRUN, NULL, voyager_data.ack_message_buffer,
                                                          sizeof(voyager_data.ack_message_buffer));
                 voyager_data.dfu_error = VOYAGER_DFU_ERROR_PACKET_OVERRUN;
+                // The flush frees every slot it drops, so nothing is popped afterwards
+                voyager_private_rx_queue_flush();
+            }
+
+            if (ret == VOYAGER_ERROR_BUSY) {
+                // The HAL is programming the packet in the background. It stays in its slot so the HAL can read the
+                // payload in place, and is processed again to finish up once the flash operation completes
+                ret = VOYAGER_ERROR_NONE;
+                break;
+            }
+
+            // Free the slot before the host can answer the ACK with its next packet
+            if (overrun == false) {
+                voyager_private_rx_queue_pop();
             }
 
             // Send the ACK
-            if (ret == VOYAGER_ERROR_NONE) {
+            if ((ret == VOYAGER_ERROR_NONE) && send_ack) {
                 ret = voyager_bootloader_send_to_host(voyager_data.ack_message_buffer, sizeof(voyager_data.ack_message_buffer));
             }
-
-            voyager_data.pending_data = false;
+        } else {
+            // Nothing to write until the host's next packet arrives, so use the time to erase
+            ret = voyager_private_erase_ahead();
         }
     } while (false);
     return ret;
@@ -348,19 +454,167 @@ voyager_error_E voyager_bootloader_process_receieved_packet(uint8_t const *const
             break;
         }
 
-        if (voyager_data.pending_data) {
-            voyager_data.packet_overrun = true;
-        } else {
-            voyager_data.packet_size = length;
-            memcpy(voyager_data.message_buffer, data, length);
-            voyager_data.pending_data = true;
+        uint8_t *buffer = NULL;
+        size_t capacity = 0U;
+        ret = voyager_bootloader_acquire_rx_buffer(&buffer, &capacity);
+        if (ret == VOYAGER_ERROR_BUFFER_FULL) {
+            // The packet is dropped and the host is told about it on the next run. The count stops one short of
+            // wrapping around to the acknowledged value, so any number of drops between runs is still seen
+            const uint8_t overrun_count = (uint8_t)(voyager_data.rx_overrun_count + 1U);
+            if (overrun_count != voyager_data.rx_overrun_acknowledged) {
+                voyager_data.rx_overrun_count = overrun_count;
+            }
+            ret = VOYAGER_ERROR_NONE;
+            break;
+        }
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        memcpy(buffer, data, length);
+        ret = voyager_bootloader_commit_rx(length);
+
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_bootloader_acquire_rx_buffer(uint8_t **const buffer, size_t *const capacity) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        if ((buffer == NULL) || (capacity == NULL)) {
+            ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        if (voyager_private_rx_queue_count() >= VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH) {
+            *buffer = NULL;
+            *capacity = 0U;
+            ret = VOYAGER_ERROR_BUFFER_FULL;
+            break;
+        }
+
+        // Do not touch the slot until the consumer has finished with it
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        *buffer = voyager_data.rx_queue[voyager_data.rx_write_index & (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH - 1U)].buffer;
+        *capacity = VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE;
+        voyager_data.rx_buffer_acquired = true;
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_bootloader_commit_rx(size_t const length) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        // cppcheck-suppress knownConditionTrueFalse
+        if (length > VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE) {
+            ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        // Only the producer fills the queue, so a full queue means no buffer was acquired
+        if (voyager_private_rx_queue_count() >= VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH) {
+            ret = VOYAGER_ERROR_BUFFER_FULL;
+            break;
         }
 
+        // Without an acquire the slot holds whatever packet last passed through it
+        if (voyager_data.rx_buffer_acquired == false) {
+            ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        voyager_data.rx_queue[voyager_data.rx_write_index & (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH - 1U)].size = length;
+        voyager_data.rx_buffer_acquired = false;
+        // Publish the slot contents before the consumer can see the new write index
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        voyager_data.rx_write_index++;
     } while (false);
 
     return ret;
 }
 
+voyager_error_E voyager_bootloader_hal_op_complete(const voyager_error_E result) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    if ((result == VOYAGER_ERROR_BUSY) || (voyager_data.flash_op_state != VOYAGER_FLASH_OP_BUSY)) {
+        ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+    } else {
+        voyager_data.flash_op_result = result;
+        // Publish the result before the state, the main loop reads them in the opposite order
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        voyager_data.flash_op_state = VOYAGER_FLASH_OP_COMPLETE;
+    }
+    return ret;
+}
+
+voyager_error_E voyager_private_nvm_read(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t *const data) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    const uint32_t key_mask = (key < VOYAGER_NVM_CACHE_SIZE) ? (1UL << key) : 0U;
+    if ((voyager_data.nvm_cache_valid & key_mask) != 0U) {
+        *data = voyager_data.nvm_cache[key];
+    } else {
+        ret = voyager_bootloader_nvm_read(key, data);
+        if ((ret == VOYAGER_ERROR_NONE) && (key_mask != 0U)) {
+            voyager_data.nvm_cache[key] = *data;
+            voyager_data.nvm_cache_valid |= key_mask;
+        }
+    }
+    return ret;
+}
+
+voyager_error_E voyager_private_nvm_write(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t const *const data) {
+    voyager_error_E ret = voyager_bootloader_nvm_write(key, data);
+    if (key < VOYAGER_NVM_CACHE_SIZE) {
+        if (ret == VOYAGER_ERROR_NONE) {
+            voyager_data.nvm_cache[key] = *data;
+            voyager_data.nvm_cache_valid |= (1UL << key);
+        } else {
+            // The value in NVM is unknown after a failed write
+            voyager_data.nvm_cache_valid &= ~(1UL << key);
+        }
+    }
+    return ret;
+}
+
+void voyager_private_nvm_invalidate_cache(void) { voyager_data.nvm_cache_valid = 0U; }
+
+size_t voyager_private_rx_queue_count(void) {
+    const uint8_t write_index = voyager_data.rx_write_index;
+    const uint8_t read_index = voyager_data.rx_read_index;
+    // The indices are free-running, so the unsigned difference is the fill level even across wraparound
+    return (uint8_t)(write_index - read_index);
+}
+
+voyager_rx_slot_t *voyager_private_rx_queue_peek(void) {
+    voyager_rx_slot_t *slot = NULL;
+    if (voyager_private_rx_queue_count() > 0U) {
+        // Do not read the slot contents before the producer published them
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        slot = &voyager_data.rx_queue[voyager_data.rx_read_index & (VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH - 1U)];
+    }
+    return slot;
+}
+
+void voyager_private_rx_queue_pop(void) {
+    if (voyager_private_rx_queue_count() > 0U) {
+        // Finish with the slot before handing it back to the producer
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        voyager_data.rx_read_index++;
+    }
+}
+
+void voyager_private_rx_queue_flush(void) {
+    // Only drop what was queued when the flush started, a packet committed meanwhile is processed on the next run
+    for (size_t count = voyager_private_rx_queue_count(); count > 0U; count--) {
+        voyager_private_rx_queue_pop();
+    }
+}
+
+bool voyager_private_rx_queue_overrun(void) { return voyager_data.rx_overrun_count != voyager_data.rx_overrun_acknowledged; }
+
+void voyager_private_rx_queue_clear_overrun(void) { voyager_data.rx_overrun_acknowledged = voyager_data.rx_overrun_count; }
+
 voyager_error_E voyager_private_generate_ack_message(const voyager_dfu_error_E error, uint8_t metadata[4],
                                                      uint8_t *const message_buffer, size_t const message_size) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
@@ -406,12 +660,77 @@ voyager_message_t voyager_private_unpack_message(uint8_t *const message_buffer,
             message.message_payload.start_packet_data.app_crc |= ((uint32_t)message_buffer[5]) << 16;  // middle
             message.message_payload.start_packet_data.app_crc |= ((uint32_t)message_buffer[6]) << 8;   // middle
             message.message_payload.start_packet_data.app_crc |= ((uint32_t)message_buffer[7]) << 0;   // LSB
+
+            // The sliding window size is optional, older hosts send a stop-and-wait START message
+            message.message_payload.start_packet_data.window_size = 0U;
+            if (message_size > VOYAGER_DFU_START_WINDOW_INDEX) {
+                message.message_payload.start_packet_data.window_size = message_buffer[VOYAGER_DFU_START_WINDOW_INDEX];
+            }
+            message.message_payload.start_packet_data.ack_interval = 0U;
+            if (message_size > VOYAGER_DFU_START_ACK_INTERVAL_INDEX) {
+                message.message_payload.start_packet_data.ack_interval = message_buffer[VOYAGER_DFU_START_ACK_INTERVAL_INDEX];
+            }
+            message.message_payload.start_packet_data.flags = 0U;
+            if (message_size > VOYAGER_DFU_START_FLAGS_INDEX) {
+                message.message_payload.start_packet_data.flags = message_buffer[VOYAGER_DFU_START_FLAGS_INDEX];
+            }
+            message.message_payload.start_packet_data.lz_window_bits = 0U;
+            if (message_size > VOYAGER_DFU_START_LZ_WINDOW_BITS_INDEX) {
+                message.message_payload.start_packet_data.lz_window_bits = message_buffer[VOYAGER_DFU_START_LZ_WINDOW_BITS_INDEX];
+            }
+            message.message_payload.start_packet_data.base_crc = 0U;
+            if ((message.message_payload.start_packet_data.flags & VOYAGER_DFU_START_FLAG_DELTA) != 0U) {
+                if (message_size < VOYAGER_DFU_DELTA_START_MESSAGE_SIZE) {
+                    // Too short to hold the CRC of the application the patch applies to
+                    message.header.message_id = VOYAGER_MESSAGE_ID_UNKNOWN;
+                    break;
+                }
+                const uint8_t *const base_crc = &message_buffer[VOYAGER_DFU_START_BASE_CRC_INDEX];
+                message.message_payload.start_packet_data.base_crc |= ((uint32_t)base_crc[0]) << 24;  // MSB
+                message.message_payload.start_packet_data.base_crc |= ((uint32_t)base_crc[1]) << 16;  // middle
+                message.message_payload.start_packet_data.base_crc |= ((uint32_t)base_crc[2]) << 8;   // middle
+                message.message_payload.start_packet_data.base_crc |= ((uint32_t)base_crc[3]) << 0;   // LSB
+            }
         } break;
         case VOYAGER_MESSAGE_ID_DATA: {
             message.message_payload.data_packet_data.sequence_number = message_buffer[1];
             message.message_payload.data_packet_data.payload = &message_buffer[2];
             message.message_payload.data_packet_data.payload_size = message_size - 2;
         } break;
+        case VOYAGER_MESSAGE_ID_FILL: {
+            if (message_size < VOYAGER_DFU_FILL_MESSAGE_SIZE) {
+                // Too short to hold the fill length and value
+                message.header.message_id = VOYAGER_MESSAGE_ID_UNKNOWN;
+                break;
+            }
+
+            // unpack the fill length, big endian
+            message.message_payload.fill_packet_data.sequence_number = message_buffer[1];
+            message.message_payload.fill_packet_data.fill_length = 0;
+            message.message_payload.fill_packet_data.fill_length |= ((uint32_t)message_buffer[2]) << 16;  // MSB
+            message.message_payload.fill_packet_data.fill_length |= ((uint32_t)message_buffer[3]) << 8;   // middle
+            message.message_payload.fill_packet_data.fill_length |= ((uint32_t)message_buffer[4]) << 0;   // LSB
+            message.message_payload.fill_packet_data.fill_value = message_buffer[5];
+        } break;
+        case VOYAGER_MESSAGE_ID_QUERY: {
+            if (message_size < VOYAGER_DFU_QUERY_MESSAGE_SIZE) {
+                // Too short to hold the app size and CRC
+                message.header.message_id = VOYAGER_MESSAGE_ID_UNKNOWN;
+                break;
+            }
+
+            // unpack the app size and app CRC, all big endian
+            message.message_payload.query_packet_data.app_size = 0;
+            message.message_payload.query_packet_data.app_size |= ((uint32_t)message_buffer[1]) << 16;  // MSB
+            message.message_payload.query_packet_data.app_size |= ((uint32_t)message_buffer[2]) << 8;   // middle
+            message.message_payload.query_packet_data.app_size |= ((uint32_t)message_buffer[3]) << 0;   // LSB
+
+            message.message_payload.query_packet_data.app_crc = 0;
+            message.message_payload.query_packet_data.app_crc |= ((uint32_t)message_buffer[4]) << 24;  // MSB
+            message.message_payload.query_packet_data.app_crc |= ((uint32_t)message_buffer[5]) << 16;  // middle
+            message.message_payload.query_packet_data.app_crc |= ((uint32_t)message_buffer[6]) << 8;   // middle
+            message.message_payload.query_packet_data.app_crc |= ((uint32_t)message_buffer[7]) << 0;   // LSB
+        } break;
         case VOYAGER_MESSAGE_ID_ACK: {
             // We shouldn't be unpacking ACK messages... they are sent by device
         } break;
@@ -428,10 +747,41 @@ voyager_error_E voyager_private_init_dfu(void) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
     do {
         voyager_data.dfu_sequence_number = 0;
+        voyager_data.dfu_out_of_sequence_nacked = false;
+        voyager_data.dfu_batch_count = 0U;
+        voyager_data.dfu_batch_crc = 0xffffffff;
         voyager_data.bytes_written = 0;
+        voyager_data.dfu_running_crc = 0xffffffff;
+        voyager_data.app_verified_during_dfu = false;
+        voyager_data.flash_payload_offset = 0U;
+        voyager_data.fill_bytes_written = 0U;
+#if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+        voyager_data.flash_page_fill = 0U;
+#endif  // VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+        voyager_data.lz_output_count = 0U;
+        voyager_data.lz_flushed_count = 0U;
+        voyager_data.lz_input_offset = 0U;
+        voyager_data.lz_flags_remaining = 0U;
+        voyager_data.lz_have_token_high = false;
+        voyager_data.lz_match_remaining = 0U;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+        voyager_data.delta_header_fill = 0U;
+        voyager_data.delta_op_remaining = 0U;
+        voyager_data.delta_input_offset = 0U;
+        voyager_data.delta_output_count = 0U;
+        voyager_data.delta_copy_loaded = false;
+        voyager_data.delta_installing = false;
+        voyager_data.delta_install_offset = 0U;
+        voyager_data.checkpoint_pending = false;
+        // Packets are only processed while no flash operation is in flight, so a completed one belongs to the previous
+        // DFU and its result no longer matters
+        voyager_data.flash_op_state = VOYAGER_FLASH_OP_IDLE;
+        // Re-read NVM once per DFU session, the data path then works from the RAM shadow
+        voyager_private_nvm_invalidate_cache();
         // get the start and end addresses from NVM
         voyager_bootloader_nvm_data_t data;
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
 
         if (ret != VOYAGER_ERROR_NONE) {
             break;
@@ -439,21 +789,42 @@ voyager_error_E voyager_private_init_dfu(void) {
 
         voyager_bootloader_addr_size_t start_address = data.app_start_address;
 
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_END_ADDRESS, &data);
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_END_ADDRESS, &data);
 
+        // Erase the flash
         if (ret != VOYAGER_ERROR_NONE) {
             break;
         }
+        voyager_bootloader_addr_size_t end_address = data.app_end_address;
 
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_END_ADDRESS, &data);
+        // A delta update is reconstructed in the staging area, the application is only erased once it has been verified
+        if (voyager_data.dfu_delta) {
+            start_address = voyager_data.config->delta_staging_start_address;
+            end_address = voyager_data.config->delta_staging_end_address;
+        }
 
-        // Erase the flash
-        if (ret != VOYAGER_ERROR_NONE) {
+        voyager_data.erase_ahead_end_address = start_address + voyager_data.app_size_cached;
+
+        // A resumed DFU keeps the flash before its checkpoint and erases the rest again, it may have been part written
+        voyager_data.bytes_written = voyager_data.dfu_resume_offset;
+        voyager_data.dfu_running_crc = voyager_data.dfu_resume_crc;
+        start_address += voyager_data.dfu_resume_offset;
+        voyager_data.next_checkpoint_address = start_address + voyager_data.config->dfu_checkpoint_interval;
+
+        // With lazy erase, sectors are erased as the first write into each of them arrives
+        voyager_data.erased_until_address = start_address;
+        voyager_data.programmed_until_address = start_address;
+        voyager_data.committed_until_address = start_address;
+        if (voyager_data.config->flash_sector_info != NULL) {
             break;
         }
-        voyager_bootloader_addr_size_t end_address = data.app_end_address;
 
-        ret = voyager_bootloader_hal_erase_flash(start_address, end_address);
+        voyager_private_flash_op_begin(true, end_address);
+        ret = voyager_private_flash_op_started(voyager_bootloader_hal_erase_flash(start_address, end_address));
+        if (ret == VOYAGER_ERROR_BUSY) {
+            // The START is acknowledged straight away, the first write waits for the erase to finish
+            ret = VOYAGER_ERROR_NONE;
+        }
     } while (false);
     return ret;
 }
@@ -461,31 +832,100 @@ voyager_error_E voyager_private_init_dfu(void) {
 voyager_error_E voyager_private_process_start_packet(const voyager_message_t *const message) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
     do {
-        voyager_bootloader_nvm_data_t data;
-        data.app_size = message->message_payload.start_packet_data.app_size;
-
-        // Write the app size to NVM
-        ret = voyager_bootloader_nvm_write(VOYAGER_NVM_KEY_APP_SIZE, &data);
+        // Reject options the host depends on before the old image is touched, unknown flags included
+        const uint8_t flags = message->message_payload.start_packet_data.flags;
+        const bool compressed = (flags & VOYAGER_DFU_START_FLAG_COMPRESSED) != 0U;
+        const bool delta = (flags & VOYAGER_DFU_START_FLAG_DELTA) != 0U;
+        const bool resume = (flags & VOYAGER_DFU_START_FLAG_RESUME) != 0U;
+        bool supported = (flags & (uint8_t)~(VOYAGER_DFU_START_FLAG_COMPRESSED | VOYAGER_DFU_START_FLAG_DELTA |
+                                             VOYAGER_DFU_START_FLAG_RESUME)) == 0U;
+        // Only plain transfers are checkpointed, the decoders of the others hold state that is not stored
+        const bool checkpointing =
+            (voyager_data.config->dfu_checkpoint_interval > 0U) && (compressed == false) && (delta == false);
+        supported = supported && ((resume == false) || checkpointing);
+        if (compressed) {
+            // The host's window must fit in ours, otherwise its matches reach back further than we remember
+            const uint8_t lz_window_bits = message->message_payload.start_packet_data.lz_window_bits;
+            supported = supported && (lz_window_bits >= VOYAGER_LZ_MIN_WINDOW_BITS) &&
+                        (lz_window_bits <= VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+        }
+        if (delta) {
+            // A patch is applied to a staging area, and is not itself compressed
+            supported = supported && (compressed == false) &&
+                        (voyager_data.config->delta_staging_end_address > voyager_data.config->delta_staging_start_address);
+        }
+        voyager_dfu_error_E start_error = supported ? VOYAGER_DFU_ERROR_NONE : VOYAGER_DFU_ERROR_UNSUPPORTED_FEATURE;
 
-        if (ret != VOYAGER_ERROR_NONE) {
+        if ((start_error == VOYAGER_DFU_ERROR_NONE) && delta) {
+            ret = voyager_private_process_delta_start(message, &start_error);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+        voyager_data.dfu_resume_offset = 0U;
+        voyager_data.dfu_resume_crc = 0xffffffff;
+        if ((start_error == VOYAGER_DFU_ERROR_NONE) && resume) {
+            ret = voyager_private_process_resume_start(message, &start_error);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+        if (start_error != VOYAGER_DFU_ERROR_NONE) {
+            ret = voyager_private_generate_ack_message(start_error, NULL, voyager_data.ack_message_buffer,
+                                                       sizeof(voyager_data.ack_message_buffer));
+            voyager_data.dfu_error = start_error;
             break;
         }
+        voyager_data.dfu_compressed = compressed;
+        voyager_data.dfu_delta = delta;
 
-        // cache the app size for later use
+        // cache the app size and CRC for later use
         voyager_data.app_size_cached = message->message_payload.start_packet_data.app_size;
-        data.app_crc = message->message_payload.start_packet_data.app_crc;
+        voyager_data.app_crc_cached = message->message_payload.start_packet_data.app_crc;
+
+        voyager_data.dfu_checkpointing = checkpointing;
+        voyager_data.dfu_checkpoint_session =
+            voyager_private_checkpoint_session(voyager_data.app_size_cached, voyager_data.app_crc_cached);
+        if ((voyager_data.config->dfu_checkpoint_interval > 0U) && (resume == false)) {
+            // Drop any stored checkpoint before the application is erased again, whatever kind of DFU replaces it, so an
+            // interrupted DFU of another image can never be resumed on top of this one
+            ret = voyager_private_clear_checkpoint();
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
 
-        // Write the app CRC to NVM
-        ret = voyager_bootloader_nvm_write(VOYAGER_NVM_KEY_APP_CRC, &data);
-        if (ret != VOYAGER_ERROR_NONE) {
-            break;
+        // A delta update leaves the current application and its NVM keys alone until the staged image has been verified,
+        // and a resumed DFU recorded them when it first started
+        if ((delta == false) && (resume == false)) {
+            ret = voyager_private_record_new_image(voyager_data.app_size_cached, voyager_data.app_crc_cached);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
         }
 
-        // If we successfully wrote the app size and CRC to NVM, we send
-        // an ack with the metadata consisting of the CRC of last 7 bytes
-        // of the start message
+        // Grant the largest window the receive queue can hold without overrunning
+        const uint8_t requested_window_size = message->message_payload.start_packet_data.window_size;
+        voyager_data.dfu_window_size = 1U;
+        if (requested_window_size > 0U) {
+            voyager_data.dfu_window_size = (requested_window_size < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH)
+                                               ? requested_window_size
+                                               : (uint8_t)VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH;
+        }
 
-        voyager_bootloader_app_crc_t crc = voyager_private_calculate_crc(&voyager_data.message_buffer[1], 7);
+        // A batch can be no longer than the window, otherwise the host would stall waiting for an ACK that never comes
+        const uint8_t requested_ack_interval = message->message_payload.start_packet_data.ack_interval;
+        voyager_data.dfu_ack_interval = 1U;
+        if (requested_ack_interval > 0U) {
+            voyager_data.dfu_ack_interval =
+                (requested_ack_interval < voyager_data.dfu_window_size) ? requested_ack_interval : voyager_data.dfu_window_size;
+        }
+
+        // If we successfully wrote the app size and CRC to NVM, we send
+        // an ack with the metadata consisting of the CRC of the start message
+        // after the message ID
+        const voyager_rx_slot_t *const slot = voyager_private_rx_queue_peek();
+        voyager_bootloader_app_crc_t crc = voyager_private_calculate_crc(&slot->buffer[1], slot->size - 1U);
 
         uint8_t metadata[4] = {0};
         voyager_private_pack_crc_into_buffer(metadata, crc);
@@ -496,118 +936,1236 @@ voyager_error_E voyager_private_process_start_packet(const voyager_message_t *co
         }
         ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_NONE, metadata, voyager_data.ack_message_buffer,
                                                    sizeof(voyager_data.ack_message_buffer));
+        if ((ret == VOYAGER_ERROR_NONE) && (requested_window_size > 0U)) {
+            voyager_data.ack_message_buffer[VOYAGER_DFU_ACK_WINDOW_INDEX] = voyager_data.dfu_window_size;
+        }
+        if ((ret == VOYAGER_ERROR_NONE) && (requested_ack_interval > 0U)) {
+            voyager_data.ack_message_buffer[VOYAGER_DFU_ACK_INTERVAL_INDEX] = voyager_data.dfu_ack_interval;
+        }
 
     } while (false);
 
     return ret;
 }
 
-voyager_error_E voyager_private_process_data_packet(const voyager_message_t *const message) {
+voyager_error_E voyager_private_process_delta_start(const voyager_message_t *const message,
+                                                   voyager_dfu_error_E *const start_error) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
     do {
-        if (voyager_data.dfu_sequence_number == message->message_payload.data_packet_data.sequence_number) {
-            // Get the NVM key for the app start address
-            voyager_bootloader_nvm_data_t data;
-            ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        const voyager_bootloader_app_size_t staging_size =
+            voyager_data.config->delta_staging_end_address - voyager_data.config->delta_staging_start_address;
+        if (message->message_payload.start_packet_data.app_size > staging_size) {
+            *start_error = VOYAGER_DFU_ERROR_SIZE_TOO_LARGE;
+            break;
+        }
 
-            if (ret != VOYAGER_ERROR_NONE) {
-                break;
-            }
+        // The patch only reconstructs the new image from the application it was generated against
+        voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        if (data.app_crc != message->message_payload.start_packet_data.base_crc) {
+            *start_error = VOYAGER_DFU_ERROR_BASE_IMAGE_MISMATCH;
+            break;
+        }
 
-            // If the sequence number is correct, we write the payload to flash
-            // and increment the sequence number
-            ret = voyager_bootloader_hal_write_flash(data.app_start_address + voyager_data.bytes_written,
-                                                     message->message_payload.data_packet_data.payload,
-                                                     message->message_payload.data_packet_data.payload_size);
-            if (ret != VOYAGER_ERROR_NONE) {
-                break;
-            }
-            voyager_data.dfu_sequence_number = (voyager_data.dfu_sequence_number + 1) % 256;
-            voyager_data.bytes_written += message->message_payload.data_packet_data.payload_size;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_SIZE, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.delta_base_size = data.app_size;
 
-            // Generate the ack message, with the metadata consisting of the CRC
-            // of the sequence and payload
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.delta_base_address = data.app_start_address;
+    } while (false);
 
-            voyager_bootloader_app_crc_t crc = voyager_private_calculate_crc(
-                &voyager_data.message_buffer[1], message->message_payload.data_packet_data.payload_size + 1);
+    return ret;
+}
 
-            uint8_t metadata[4] = {0};
-            // copy the crc into the metadata in big endian
-            voyager_private_pack_crc_into_buffer(metadata, crc);
+voyager_error_E voyager_private_process_resume_start(const voyager_message_t *const message,
+                                                    voyager_dfu_error_E *const start_error) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_bootloader_app_size_t offset = 0U;
+        ret = voyager_private_find_checkpoint(message->message_payload.start_packet_data.app_size,
+                                              message->message_payload.start_packet_data.app_crc, &offset);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        if (offset == 0U) {
+            *start_error = VOYAGER_DFU_ERROR_NO_CHECKPOINT;
+            break;
+        }
 
-            // Generate the ack message
-            ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_NONE, metadata, voyager_data.ack_message_buffer,
-                                                       sizeof(voyager_data.ack_message_buffer));
+        voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        voyager_data.dfu_resume_offset = offset;
+        voyager_data.dfu_resume_crc = data.dfu_checkpoint_crc;
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_process_query_packet(const voyager_message_t *const message) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_bootloader_app_size_t offset = 0U;
+        if (voyager_data.config->dfu_checkpoint_interval > 0U) {
+            ret = voyager_private_find_checkpoint(message->message_payload.query_packet_data.app_size,
+                                                  message->message_payload.query_packet_data.app_crc, &offset);
             if (ret != VOYAGER_ERROR_NONE) {
                 break;
             }
-
-        } else {
-            ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE, NULL, voyager_data.ack_message_buffer,
-                                                       sizeof(voyager_data.ack_message_buffer));
-            voyager_data.dfu_error = VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE;
         }
 
+        // The metadata holds the offset the host resumes sending the application from, 0 if it has to start over
+        uint8_t metadata[4] = {0};
+        voyager_private_pack_crc_into_buffer(metadata, offset);
+        ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_NONE, metadata, voyager_data.ack_message_buffer,
+                                                   sizeof(voyager_data.ack_message_buffer));
     } while (false);
 
     return ret;
 }
 
-voyager_error_E voyager_private_verify_flash(bool *const result) {
+voyager_error_E voyager_private_find_checkpoint(const voyager_bootloader_app_size_t app_size,
+                                                const voyager_bootloader_app_crc_t app_crc,
+                                                voyager_bootloader_app_size_t *const offset) {
     voyager_error_E ret = VOYAGER_ERROR_NONE;
+    *offset = 0U;
     do {
         voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION, &data);
+        if ((ret != VOYAGER_ERROR_NONE) ||
+            (data.dfu_checkpoint_session != voyager_private_checkpoint_session(app_size, app_crc))) {
+            break;
+        }
 
-        // Get the NVM key for the app CRC
-        voyager_bootloader_app_crc_t app_crc;
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_CRC, &data);
-        app_crc = data.app_crc;
-
-        // Get the NVM key for the app start address
-
-        voyager_bootloader_addr_size_t app_start_address;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_DFU_CHECKPOINT_OFFSET, &data);
         if (ret != VOYAGER_ERROR_NONE) {
             break;
         }
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        const voyager_bootloader_app_size_t checkpoint_offset = data.dfu_checkpoint_offset;
+
+        if (voyager_data.config->flash_sector_info != NULL) {
+            // Lazy erase erases the whole sector a resumed DFU starts in, which would lose the flash before the checkpoint
+            ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+            const voyager_bootloader_addr_size_t resume_address = data.app_start_address + checkpoint_offset;
+            voyager_bootloader_addr_size_t sector_start = 0U;
+            voyager_bootloader_addr_size_t sector_end = 0U;
+            ret = voyager_data.config->flash_sector_info(resume_address, &sector_start, &sector_end);
+            if ((ret != VOYAGER_ERROR_NONE) || (sector_start != resume_address)) {
+                break;
+            }
+        }
 
-        app_start_address = data.app_start_address;
+        *offset = checkpoint_offset;
+    } while (false);
 
-        // Get the NVM key for the app size
-        voyager_bootloader_app_size_t app_size;
+    return ret;
+}
+
+uint32_t voyager_private_checkpoint_session(const voyager_bootloader_app_size_t app_size,
+                                            const voyager_bootloader_app_crc_t app_crc) {
+    // The CRC of the size and CRC fields as they appear in the START message
+    uint8_t fields[7] = {0};
+    fields[0] = (uint8_t)(app_size >> 16);
+    fields[1] = (uint8_t)(app_size >> 8);
+    fields[2] = (uint8_t)app_size;
+    voyager_private_pack_crc_into_buffer(&fields[3], app_crc);
+    return voyager_private_calculate_crc(fields, sizeof(fields));
+}
+
+voyager_error_E voyager_private_store_checkpoint(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        ret = voyager_private_clear_checkpoint();
         if (ret != VOYAGER_ERROR_NONE) {
             break;
         }
-        ret = voyager_bootloader_nvm_read(VOYAGER_NVM_KEY_APP_SIZE, &data);
-
-        app_size = data.app_size;
 
-        voyager_bootloader_app_crc_t calculated_crc = 0xffffffff;
+        voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        data.dfu_checkpoint_offset = voyager_data.checkpoint_address - data.app_start_address;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_DFU_CHECKPOINT_OFFSET, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
 
-        // Iterate through the flash and calculate the CRC
-        for (size_t i = 0; i < app_size; i++) {
-            uint8_t byte = 0;
-            // TODO: optimize this to read more than 1 byte at a time if possible
-            ret = voyager_bootloader_hal_read_flash(app_start_address + i, &byte, 1);
-            if (ret != VOYAGER_ERROR_NONE) {
-                break;
-            }
-            voyager_private_calculate_crc_stream(byte, &calculated_crc);
+        data.dfu_checkpoint_crc = voyager_data.checkpoint_crc;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
         }
 
-        // Compare the calculated CRC to the stored CRC
+        data.dfu_checkpoint_session = voyager_data.dfu_checkpoint_session;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION, &data);
         if (ret != VOYAGER_ERROR_NONE) {
             break;
         }
-        *result = (calculated_crc == app_crc);
+
+        voyager_data.checkpoint_pending = false;
     } while (false);
 
     return ret;
 }
 
-void voyager_private_pack_crc_into_buffer(uint8_t buffer[4], const voyager_bootloader_app_crc_t crc) {
-    // memset the buffer to 0
-    memset(buffer, 0, 4);
+voyager_error_E voyager_private_clear_checkpoint(void) {
+    // The inverted session can never match this DFU
+    voyager_bootloader_nvm_data_t data;
+    data.dfu_checkpoint_session = ~voyager_data.dfu_checkpoint_session;
+    return voyager_private_nvm_write(VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION, &data);
+}
+
+voyager_error_E voyager_private_record_new_image(const voyager_bootloader_app_size_t app_size,
+                                                 const voyager_bootloader_app_crc_t app_crc) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_bootloader_nvm_data_t data;
+
+        if (voyager_data.config->verify_policy != VOYAGER_VERIFY_POLICY_ALWAYS) {
+            // Invalidate the verified marker before the old image is touched. The inverted CRC can never match the new CRC
+            data.app_verified_crc = ~app_crc;
+            ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_VERIFIED_CRC, &data);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+
+        // Write the app size to NVM
+        data.app_size = app_size;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_SIZE, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        // Write the app CRC to NVM
+        data.app_crc = app_crc;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_CRC, &data);
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_process_data_packet(const voyager_message_t *const message, bool *const send_ack) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        *send_ack = true;
+        // A FILL packet takes the place of a DATA packet whose payload is fill_length bytes of fill_value
+        const bool fill = (message->header.message_id == VOYAGER_MESSAGE_ID_FILL);
+        const uint8_t sequence_number = fill ? message->message_payload.fill_packet_data.sequence_number
+                                             : message->message_payload.data_packet_data.sequence_number;
+        const voyager_bootloader_app_size_t length =
+            fill ? message->message_payload.fill_packet_data.fill_length : message->message_payload.data_packet_data.payload_size;
+
+        if (voyager_data.dfu_sequence_number == sequence_number) {
+            voyager_data.dfu_out_of_sequence_nacked = false;
+
+            if (fill && (voyager_data.dfu_compressed || voyager_data.dfu_delta)) {
+                // A run is cheap to describe in a compressed stream or a patch, which FILL would bypass
+                ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_INVALID_MESSAGE_ID, NULL,
+                                                           voyager_data.ack_message_buffer,
+                                                           sizeof(voyager_data.ack_message_buffer));
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_INVALID_MESSAGE_ID;
+                break;
+            }
+
+            if (fill && (length > (voyager_data.app_size_cached - voyager_data.bytes_written))) {
+                // The fill would run past the end of the application
+                ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_SIZE_TOO_LARGE, NULL,
+                                                           voyager_data.ack_message_buffer,
+                                                           sizeof(voyager_data.ack_message_buffer));
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_SIZE_TOO_LARGE;
+                break;
+            }
+
+            // Get the NVM key for the app start address
+            voyager_bootloader_nvm_data_t data;
+            ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            // If the sequence number is correct, we write the payload to flash
+            // and increment the sequence number
+            const voyager_bootloader_addr_size_t address = data.app_start_address + voyager_data.bytes_written;
+            // Number of application bytes the packet covers
+            voyager_bootloader_app_size_t packet_output = length;
+            if (fill) {
+                ret = voyager_private_write_fill(address, length, message->message_payload.fill_packet_data.fill_value);
+            } else if (voyager_data.dfu_compressed) {
+                ret = voyager_private_write_compressed_payload(
+                    data.app_start_address, message->message_payload.data_packet_data.payload, length, &packet_output);
+            } else if (voyager_data.dfu_delta) {
+                ret = voyager_private_write_patch_payload(message->message_payload.data_packet_data.payload, length,
+                                                          &packet_output);
+            } else {
+                ret = voyager_private_write_dfu_payload(address, message->message_payload.data_packet_data.payload, length);
+            }
+            if (voyager_data.dfu_error != VOYAGER_DFU_ERROR_NONE) {
+                ret = voyager_private_generate_ack_message(voyager_data.dfu_error, NULL, voyager_data.ack_message_buffer,
+                                                           sizeof(voyager_data.ack_message_buffer));
+                break;
+            }
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            const bool last_packet = (voyager_data.bytes_written + packet_output) == voyager_data.app_size_cached;
+            if (last_packet && (voyager_data.delta_installing == false)) {
+                // Write the tail of the application that is still waiting for the rest of its page
+                ret = voyager_private_flush_flash_page();
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+
+            if (last_packet && voyager_data.dfu_delta) {
+                ret = voyager_private_install_staged_image();
+                if (voyager_data.dfu_error != VOYAGER_DFU_ERROR_NONE) {
+                    ret = voyager_private_generate_ack_message(voyager_data.dfu_error, NULL, voyager_data.ack_message_buffer,
+                                                               sizeof(voyager_data.ack_message_buffer));
+                    break;
+                }
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+
+            // Only advance once the packet is fully in flash, an asynchronous write processes the packet again
+            voyager_data.flash_payload_offset = 0U;
+            voyager_data.fill_bytes_written = 0U;
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+            voyager_data.lz_input_offset = 0U;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+            voyager_data.delta_input_offset = 0U;
+            voyager_data.dfu_sequence_number = (voyager_data.dfu_sequence_number + 1) % 256;
+            voyager_data.bytes_written += packet_output;
+
+            if (last_packet && voyager_data.config->verify_crc_during_dfu) {
+                voyager_data.app_verified_during_dfu = (voyager_data.dfu_running_crc == voyager_data.app_crc_cached);
+            }
+
+            if (voyager_data.dfu_checkpointing) {
+                // A complete DFU has nothing left to resume
+                ret = last_packet ? voyager_private_clear_checkpoint()
+                                  : (voyager_data.checkpoint_pending ? voyager_private_store_checkpoint() : VOYAGER_ERROR_NONE);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+
+            // Generate the ack message, with the metadata consisting of the CRC
+            // of the sequence and payload
+            ret = voyager_private_generate_data_ack(sequence_number, send_ack);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+        } else if (voyager_data.dfu_window_size > 1U) {
+            // Go-back-N: drop the packet and tell the host which sequence number to resume from. Only the first
+            // packet after a gap is NACKed, the rest of the window in flight is dropped silently
+            if (voyager_data.dfu_out_of_sequence_nacked) {
+                *send_ack = false;
+                break;
+            }
+
+            uint8_t metadata[4] = {0};
+            metadata[0] = voyager_data.dfu_sequence_number;
+            ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE, metadata,
+                                                       voyager_data.ack_message_buffer, sizeof(voyager_data.ack_message_buffer));
+            voyager_data.dfu_out_of_sequence_nacked = true;
+
+            // The resume sequence number acknowledges everything before the gap, so the batch starts over
+            voyager_data.dfu_batch_count = 0U;
+            voyager_data.dfu_batch_crc = 0xffffffff;
+        } else {
+            ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE, NULL, voyager_data.ack_message_buffer,
+                                                       sizeof(voyager_data.ack_message_buffer));
+            voyager_data.dfu_error = VOYAGER_DFU_ERROR_OUT_OF_SEQUENCE;
+        }
+
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_generate_data_ack(const uint8_t sequence_number, bool *const send_ack) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        // Everything after the message ID, i.e. the sequence number and the payload or fill description
+        const voyager_rx_slot_t *const slot = voyager_private_rx_queue_peek();
+        const uint8_t *const sequence_and_payload = &slot->buffer[1];
+        const size_t sequence_and_payload_size = slot->size - 1U;
+
+        if (voyager_data.dfu_ack_interval <= 1U) {
+            voyager_bootloader_app_crc_t crc = voyager_private_calculate_crc(sequence_and_payload, sequence_and_payload_size);
+
+            uint8_t metadata[4] = {0};
+            // copy the crc into the metadata in big endian
+            voyager_private_pack_crc_into_buffer(metadata, crc);
+
+            // Generate the ack message
+            ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_NONE, metadata, voyager_data.ack_message_buffer,
+                                                       sizeof(voyager_data.ack_message_buffer));
+            break;
+        }
+
+        // Batched mode: the CRC covers the sequence numbers and payloads of every packet in the batch
+        voyager_private_calculate_crc_block(sequence_and_payload, sequence_and_payload_size, &voyager_data.dfu_batch_crc);
+        voyager_data.dfu_batch_count++;
+
+        if ((voyager_data.dfu_batch_count < voyager_data.dfu_ack_interval) &&
+            (voyager_data.bytes_written < voyager_data.app_size_cached)) {
+            *send_ack = false;
+            break;
+        }
+
+        uint8_t metadata[4] = {0};
+        voyager_private_pack_crc_into_buffer(metadata, voyager_data.dfu_batch_crc);
+        ret = voyager_private_generate_ack_message(VOYAGER_DFU_ERROR_NONE, metadata, voyager_data.ack_message_buffer,
+                                                   sizeof(voyager_data.ack_message_buffer));
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.ack_message_buffer[VOYAGER_DFU_ACK_SEQUENCE_INDEX] = sequence_number;
+        voyager_data.ack_message_buffer[VOYAGER_DFU_ACK_COUNT_INDEX] = voyager_data.dfu_batch_count;
+
+        voyager_data.dfu_batch_count = 0U;
+        voyager_data.dfu_batch_crc = 0xffffffff;
+    } while (false);
+
+    return ret;
+}
+
+bool voyager_private_flash_op_pending(void) { return voyager_data.flash_op_state == VOYAGER_FLASH_OP_BUSY; }
+
+voyager_error_E voyager_private_flash_op_poll(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    const uint8_t state = voyager_data.flash_op_state;
+    if (state == VOYAGER_FLASH_OP_BUSY) {
+        ret = VOYAGER_ERROR_BUSY;
+    } else if (state == VOYAGER_FLASH_OP_COMPLETE) {
+        // Pairs with the barrier in voyager_bootloader_hal_op_complete
+        VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+        ret = voyager_data.flash_op_result;
+        voyager_data.flash_op_state = VOYAGER_FLASH_OP_IDLE;
+        if (ret == VOYAGER_ERROR_NONE) {
+            if (voyager_data.flash_op_is_erase) {
+                voyager_data.erased_until_address = voyager_data.flash_op_end_address;
+            } else {
+                voyager_data.programmed_until_address = voyager_data.flash_op_end_address;
+            }
+        }
+    }
+    return ret;
+}
+
+void voyager_private_flash_op_begin(const bool is_erase, const voyager_bootloader_addr_size_t end_address) {
+    voyager_data.flash_op_is_erase = is_erase;
+    voyager_data.flash_op_end_address = end_address;
+    // Set before calling the HAL, which may complete the operation before it returns
+    voyager_data.flash_op_state = VOYAGER_FLASH_OP_BUSY;
+    VOYAGER_BOOTLOADER_MEMORY_BARRIER();
+}
+
+voyager_error_E voyager_private_flash_op_started(const voyager_error_E hal_result) {
+    voyager_error_E ret = hal_result;
+    if (ret != VOYAGER_ERROR_BUSY) {
+        // The HAL finished the operation synchronously
+        voyager_data.flash_op_result = ret;
+        voyager_data.flash_op_state = VOYAGER_FLASH_OP_COMPLETE;
+        ret = voyager_private_flash_op_poll();
+    }
+    return ret;
+}
+
+voyager_error_E voyager_private_erase_before_write(const voyager_bootloader_addr_size_t address, const size_t length) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    if (voyager_data.config->flash_sector_info != NULL) {
+        // Writes arrive in address order, so everything below erased_until_address is already erased
+        while (voyager_data.erased_until_address < (address + length)) {
+            voyager_bootloader_addr_size_t sector_start = 0U;
+            voyager_bootloader_addr_size_t sector_end = 0U;
+            ret = voyager_data.config->flash_sector_info(voyager_data.erased_until_address, &sector_start, &sector_end);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            if ((sector_start > voyager_data.erased_until_address) || (sector_end <= voyager_data.erased_until_address)) {
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+
+            voyager_private_flash_op_begin(true, sector_end);
+            ret = voyager_private_flash_op_started(voyager_bootloader_hal_erase_flash(sector_start, sector_end));
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+voyager_error_E voyager_private_erase_ahead(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        // Only erase while the DFU still has application bytes to come
+        if ((voyager_data.config->background_erase == false) || (voyager_data.config->flash_sector_info == NULL) ||
+            (voyager_data.dfu_error != VOYAGER_DFU_ERROR_NONE) ||
+            (voyager_data.bytes_written >= voyager_data.app_size_cached)) {
+            break;
+        }
+
+        // Pick up the result of the previous sector
+        ret = voyager_private_flash_op_poll();
+        if ((ret != VOYAGER_ERROR_NONE) || (voyager_data.erased_until_address >= voyager_data.erase_ahead_end_address)) {
+            break;
+        }
+
+        // One sector per call, so a packet that arrives in the meantime waits for no more than one erase
+        ret = voyager_private_erase_before_write(voyager_data.erased_until_address, 1U);
+        if (ret == VOYAGER_ERROR_BUSY) {
+            ret = VOYAGER_ERROR_NONE;
+        }
+    } while (false);
+
+    return ret;
+}
+
+size_t voyager_private_next_write_run(const uint8_t *const data, const size_t length, const size_t min_skip_run,
+                                      bool *const erased) {
+    size_t index = 0U;
+    while ((index < length) && (data[index] == VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE)) {
+        index++;
+    }
+
+    *erased = (index == length) || (index >= min_skip_run);
+    size_t run_length = index;
+    if (*erased == false) {
+        // Write up to the next run of the erased value that is long enough to skip
+        size_t erased_run = 0U;
+        for (; index < length; index++) {
+            if (data[index] != VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE) {
+                erased_run = 0U;
+            } else if (++erased_run >= min_skip_run) {
+                break;
+            }
+        }
+        run_length = (index < length) ? (index + 1U - erased_run) : length;
+    }
+
+    return run_length;
+}
+
+voyager_error_E voyager_private_write_flash(const voyager_bootloader_addr_size_t address, const uint8_t *const data,
+                                            const size_t length) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        // Pick up where an asynchronous erase or write left off
+        ret = voyager_private_flash_op_poll();
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        if ((address + length) <= voyager_data.committed_until_address) {
+            break;
+        }
+
+        ret = voyager_private_erase_before_write(address, length);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        // A coalesced page is only skipped as a whole, so every write stays page aligned
+        const size_t min_skip_run = voyager_data.config->coalesce_flash_writes ? length : VOYAGER_BOOTLOADER_ERASED_SKIP_MIN_RUN;
+        while (voyager_data.programmed_until_address < (address + length)) {
+            const voyager_bootloader_addr_size_t run_address =
+                (voyager_data.programmed_until_address > address) ? voyager_data.programmed_until_address : address;
+            const size_t offset = run_address - address;
+            bool erased = false;
+            size_t run_length = length - offset;
+            if (voyager_data.config->skip_erased_writes) {
+                run_length = voyager_private_next_write_run(&data[offset], length - offset, min_skip_run, &erased);
+            }
+
+            if (erased) {
+                // The freshly erased flash already holds this run
+                voyager_data.programmed_until_address = run_address + run_length;
+                continue;
+            }
+
+            voyager_private_flash_op_begin(false, run_address + run_length);
+            ret = voyager_private_flash_op_started(voyager_bootloader_hal_write_flash(run_address, &data[offset], run_length));
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        // A staged delta update is always checked before it replaces the application
+        const bool accumulate_crc = voyager_data.config->verify_crc_during_dfu || voyager_data.dfu_delta;
+        size_t crc_offset = 0U;
+        while (voyager_data.dfu_checkpointing && (voyager_data.next_checkpoint_address <= (address + length))) {
+            // Split the CRC at the checkpoint, a resumed DFU continues from exactly there
+            const size_t checkpoint_offset = voyager_data.next_checkpoint_address - address;
+            if (accumulate_crc) {
+                ret = voyager_private_accumulate_dfu_crc(address + crc_offset, &data[crc_offset], checkpoint_offset - crc_offset);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+            crc_offset = checkpoint_offset;
+            voyager_data.checkpoint_pending = true;
+            voyager_data.checkpoint_address = voyager_data.next_checkpoint_address;
+            voyager_data.checkpoint_crc = voyager_data.dfu_running_crc;
+            voyager_data.next_checkpoint_address += voyager_data.config->dfu_checkpoint_interval;
+        }
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        if (accumulate_crc) {
+            ret = voyager_private_accumulate_dfu_crc(address + crc_offset, &data[crc_offset], length - crc_offset);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+
+        voyager_data.committed_until_address = address + length;
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_write_dfu_payload(const voyager_bootloader_addr_size_t address, const uint8_t *const data,
+                                                  const size_t length) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+#if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+    if (voyager_data.config->coalesce_flash_writes) {
+        while (true) {
+            // A full page is written out before anything else is buffered, which also resumes an asynchronous write
+            const voyager_bootloader_addr_size_t next_address = voyager_data.flash_page_address + voyager_data.flash_page_fill;
+            if ((voyager_data.flash_page_fill > 0U) && ((next_address % VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE) == 0U)) {
+                ret = voyager_private_flush_flash_page();
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+
+            const size_t offset = voyager_data.flash_payload_offset;
+            if (offset == length) {
+                break;
+            }
+
+            if (voyager_data.flash_page_fill == 0U) {
+                voyager_data.flash_page_address = address + offset;
+            }
+
+            // Fill the buffer up to the next page boundary at most
+            const voyager_bootloader_addr_size_t fill_address = voyager_data.flash_page_address + voyager_data.flash_page_fill;
+            size_t chunk_size = VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE - (fill_address % VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE);
+            if (chunk_size > length - offset) {
+                chunk_size = length - offset;
+            }
+
+            memcpy(&voyager_data.flash_page_buffer[voyager_data.flash_page_fill], &data[offset], chunk_size);
+            voyager_data.flash_page_fill += chunk_size;
+            voyager_data.flash_payload_offset += chunk_size;
+        }
+    } else
+#endif  // VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+    {
+        ret = voyager_private_write_flash(address, data, length);
+    }
+
+    return ret;
+}
+
+voyager_error_E voyager_private_flush_flash_page(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+#if VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+    if (voyager_data.flash_page_fill > 0U) {
+        ret = voyager_private_write_flash(voyager_data.flash_page_address, voyager_data.flash_page_buffer,
+                                          voyager_data.flash_page_fill);
+        if (ret == VOYAGER_ERROR_NONE) {
+            voyager_data.flash_page_fill = 0U;
+        }
+    }
+#endif  // VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE > 0
+    return ret;
+}
+
+voyager_error_E voyager_private_write_fill(const voyager_bootloader_addr_size_t address,
+                                           const voyager_bootloader_app_size_t fill_length, const uint8_t fill_value) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    // The buffer holds the same value for every chunk, so it is only set up when the FILL starts
+    if (voyager_data.fill_bytes_written == 0U) {
+        memset(voyager_data.fill_buffer, fill_value, sizeof(voyager_data.fill_buffer));
+    }
+
+    while (voyager_data.fill_bytes_written < fill_length) {
+        size_t chunk_size = sizeof(voyager_data.fill_buffer);
+        if (chunk_size > (fill_length - voyager_data.fill_bytes_written)) {
+            chunk_size = fill_length - voyager_data.fill_bytes_written;
+        }
+
+        ret = voyager_private_write_dfu_payload(address + voyager_data.fill_bytes_written, voyager_data.fill_buffer, chunk_size);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        voyager_data.flash_payload_offset = 0U;
+        voyager_data.fill_bytes_written += chunk_size;
+    }
+
+    return ret;
+}
+
+voyager_error_E voyager_private_write_compressed_payload(const voyager_bootloader_addr_size_t start_address,
+                                                         const uint8_t *const data, const size_t length,
+                                                         voyager_bootloader_app_size_t *const output) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+    // The stream is a sequence of groups of eight items, each group preceded by a flags byte read LSB first. A set flag is
+    // a literal byte, a clear flag a big endian 16 bit token holding the match offset - 1 above the match length - 3. All
+    // decoder state lives in voyager_data, so a payload resumes where it left off after an asynchronous write
+    while (true) {
+        // The oldest byte in the window is only overwritten once it has been handed to flash
+        if ((voyager_data.lz_output_count - voyager_data.lz_flushed_count) == VOYAGER_LZ_WINDOW_SIZE) {
+            ret = voyager_private_flush_decompressed(start_address);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+
+        bool have_byte = false;
+        uint8_t byte = 0U;
+        if (voyager_data.lz_match_remaining > 0U) {
+            byte = voyager_data.lz_window[(voyager_data.lz_output_count - voyager_data.lz_match_offset) &
+                                          (VOYAGER_LZ_WINDOW_SIZE - 1U)];
+            voyager_data.lz_match_remaining--;
+            have_byte = true;
+        } else if (voyager_data.lz_input_offset == length) {
+            break;
+        } else if (voyager_data.lz_flags_remaining == 0U) {
+            voyager_data.lz_flags = data[voyager_data.lz_input_offset++];
+            voyager_data.lz_flags_remaining = 8U;
+        } else if ((voyager_data.lz_flags & 0x01U) != 0U) {
+            byte = data[voyager_data.lz_input_offset++];
+            voyager_data.lz_flags >>= 1U;
+            voyager_data.lz_flags_remaining--;
+            have_byte = true;
+        } else if (voyager_data.lz_have_token_high == false) {
+            voyager_data.lz_token_high = data[voyager_data.lz_input_offset++];
+            voyager_data.lz_have_token_high = true;
+        } else {
+            const uint16_t token = (uint16_t)(((uint16_t)voyager_data.lz_token_high << 8) | data[voyager_data.lz_input_offset++]);
+            voyager_data.lz_have_token_high = false;
+            voyager_data.lz_flags >>= 1U;
+            voyager_data.lz_flags_remaining--;
+
+            const uint16_t match_offset = (uint16_t)((token >> VOYAGER_LZ_LENGTH_BITS) + 1U);
+            if ((match_offset > VOYAGER_LZ_WINDOW_SIZE) || (match_offset > voyager_data.lz_output_count)) {
+                // The match reaches back past the window or the start of the application
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_INVALID_COMPRESSED_DATA;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+            voyager_data.lz_match_offset = match_offset;
+            voyager_data.lz_match_remaining =
+                (uint8_t)((token & ((1U << VOYAGER_LZ_LENGTH_BITS) - 1U)) + VOYAGER_LZ_MIN_MATCH_LENGTH);
+        }
+
+        if (have_byte) {
+            if (voyager_data.lz_output_count == voyager_data.app_size_cached) {
+                // The stream decompresses to more than the application
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_SIZE_TOO_LARGE;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+            voyager_data.lz_window[voyager_data.lz_output_count & (VOYAGER_LZ_WINDOW_SIZE - 1U)] = byte;
+            voyager_data.lz_output_count++;
+        }
+    }
+
+    // The packet is only acknowledged once everything it decompressed to is in flash
+    if (ret == VOYAGER_ERROR_NONE) {
+        ret = voyager_private_flush_decompressed(start_address);
+    }
+    if (ret == VOYAGER_ERROR_NONE) {
+        *output = voyager_data.lz_output_count - voyager_data.bytes_written;
+    }
+#else
+    (void)start_address;
+    (void)data;
+    (void)length;
+    (void)output;
+    ret = VOYAGER_ERROR_NOT_IMPLEMENTED;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+    return ret;
+}
+
+voyager_error_E voyager_private_write_patch_payload(const uint8_t *const data, const size_t length,
+                                                    voyager_bootloader_app_size_t *const output) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    // The patch is a sequence of COPY ops, which copy a run of the current application, and INSERT ops, which carry new
+    // bytes. All patcher state lives in voyager_data, so a payload resumes where it left off after an asynchronous write
+    while (true) {
+        if (voyager_data.delta_op_remaining == 0U) {
+            // Collect the header of the next op, which may straddle two payloads
+            if (voyager_data.delta_input_offset == length) {
+                break;
+            }
+            voyager_data.delta_header[voyager_data.delta_header_fill++] = data[voyager_data.delta_input_offset++];
+
+            const uint8_t op = voyager_data.delta_header[0];
+            size_t header_size = 0U;
+            if (op == VOYAGER_DELTA_OP_COPY) {
+                header_size = VOYAGER_DELTA_COPY_HEADER_SIZE;
+            } else if (op == VOYAGER_DELTA_OP_INSERT) {
+                header_size = VOYAGER_DELTA_INSERT_HEADER_SIZE;
+            } else {
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_INVALID_PATCH;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+            if (voyager_data.delta_header_fill < header_size) {
+                continue;
+            }
+            voyager_data.delta_header_fill = 0U;
+
+            // The length is the last 3 bytes of both headers, big endian
+            const uint8_t *const length_bytes = &voyager_data.delta_header[header_size - 3U];
+            const voyager_bootloader_app_size_t op_length =
+                ((uint32_t)length_bytes[0] << 16) | ((uint32_t)length_bytes[1] << 8) | (uint32_t)length_bytes[2];
+            const voyager_bootloader_app_size_t source_offset = ((uint32_t)voyager_data.delta_header[1] << 16) |
+                                                                ((uint32_t)voyager_data.delta_header[2] << 8) |
+                                                                (uint32_t)voyager_data.delta_header[3];
+
+            if ((op_length == 0U) ||
+                ((op == VOYAGER_DELTA_OP_COPY) && ((source_offset > voyager_data.delta_base_size) ||
+                                                   (op_length > (voyager_data.delta_base_size - source_offset))))) {
+                // Empty ops and copies from outside the current application are never generated
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_INVALID_PATCH;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+            if (op_length > (voyager_data.app_size_cached - voyager_data.delta_output_count)) {
+                // The op would run past the end of the application
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_SIZE_TOO_LARGE;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+
+            voyager_data.delta_op = op;
+            voyager_data.delta_op_remaining = op_length;
+            voyager_data.delta_source_offset = source_offset;
+            continue;
+        }
+
+        const voyager_bootloader_addr_size_t address =
+            voyager_data.config->delta_staging_start_address + voyager_data.delta_output_count;
+        size_t chunk_size = voyager_data.delta_op_remaining;
+        if (voyager_data.delta_op == VOYAGER_DELTA_OP_INSERT) {
+            if (voyager_data.delta_input_offset == length) {
+                break;
+            }
+            if (chunk_size > (length - voyager_data.delta_input_offset)) {
+                chunk_size = length - voyager_data.delta_input_offset;
+            }
+
+            ret = voyager_private_write_dfu_payload(address, &data[voyager_data.delta_input_offset], chunk_size);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+            voyager_data.delta_input_offset += chunk_size;
+        } else {
+            if (chunk_size > sizeof(voyager_data.delta_copy_buffer)) {
+                chunk_size = sizeof(voyager_data.delta_copy_buffer);
+            }
+
+            if (voyager_data.delta_copy_loaded == false) {
+                ret = voyager_bootloader_hal_read_flash(voyager_data.delta_base_address + voyager_data.delta_source_offset,
+                                                        voyager_data.delta_copy_buffer, chunk_size);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+                voyager_data.delta_copy_loaded = true;
+            }
+
+            ret = voyager_private_write_dfu_payload(address, voyager_data.delta_copy_buffer, chunk_size);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+            voyager_data.delta_copy_loaded = false;
+            voyager_data.delta_source_offset += chunk_size;
+        }
+
+        voyager_data.flash_payload_offset = 0U;
+        voyager_data.delta_op_remaining -= chunk_size;
+        voyager_data.delta_output_count += chunk_size;
+    }
+
+    if (ret == VOYAGER_ERROR_NONE) {
+        *output = voyager_data.delta_output_count - voyager_data.bytes_written;
+    }
+    return ret;
+}
+
+voyager_error_E voyager_private_install_staged_image(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        const voyager_bootloader_addr_size_t start_address = data.app_start_address;
+
+        if (voyager_data.delta_installing == false) {
+            if (voyager_data.dfu_running_crc != voyager_data.app_crc_cached) {
+                // The current application is left untouched
+                voyager_data.dfu_error = VOYAGER_DFU_ERROR_INVALID_PATCH;
+                ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+
+            ret = voyager_private_record_new_image(voyager_data.app_size_cached, voyager_data.app_crc_cached);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_END_ADDRESS, &data);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            // The copy goes through the same write path as a full DFU, so it is erased, coalesced and CRC checked the same
+            voyager_data.delta_installing = true;
+            voyager_data.delta_install_offset = 0U;
+            voyager_data.dfu_running_crc = 0xffffffff;
+            voyager_data.erased_until_address = start_address;
+            voyager_data.programmed_until_address = start_address;
+            voyager_data.committed_until_address = start_address;
+            if (voyager_data.config->flash_sector_info == NULL) {
+                voyager_private_flash_op_begin(true, data.app_end_address);
+                ret = voyager_private_flash_op_started(voyager_bootloader_hal_erase_flash(start_address, data.app_end_address));
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+            }
+        }
+
+        while (voyager_data.delta_install_offset < voyager_data.app_size_cached) {
+            size_t chunk_size = voyager_data.app_size_cached - voyager_data.delta_install_offset;
+            if (chunk_size > sizeof(voyager_data.delta_copy_buffer)) {
+                chunk_size = sizeof(voyager_data.delta_copy_buffer);
+            }
+
+            if (voyager_data.delta_copy_loaded == false) {
+                ret = voyager_bootloader_hal_read_flash(
+                    voyager_data.config->delta_staging_start_address + voyager_data.delta_install_offset,
+                    voyager_data.delta_copy_buffer, chunk_size);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+                voyager_data.delta_copy_loaded = true;
+            }
+
+            ret = voyager_private_write_dfu_payload(start_address + voyager_data.delta_install_offset,
+                                                    voyager_data.delta_copy_buffer, chunk_size);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+            voyager_data.delta_copy_loaded = false;
+            voyager_data.flash_payload_offset = 0U;
+            voyager_data.delta_install_offset += chunk_size;
+        }
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        ret = voyager_private_flush_flash_page();
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_flush_decompressed(const voyager_bootloader_addr_size_t start_address) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+#if VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+    while (voyager_data.lz_flushed_count != voyager_data.lz_output_count) {
+        // The pending bytes may wrap around the end of the window, each contiguous piece is written separately
+        const size_t index = voyager_data.lz_flushed_count & (VOYAGER_LZ_WINDOW_SIZE - 1U);
+        size_t chunk_size = VOYAGER_LZ_WINDOW_SIZE - index;
+        if (chunk_size > (voyager_data.lz_output_count - voyager_data.lz_flushed_count)) {
+            chunk_size = voyager_data.lz_output_count - voyager_data.lz_flushed_count;
+        }
+
+        ret = voyager_private_write_dfu_payload(start_address + voyager_data.lz_flushed_count, &voyager_data.lz_window[index],
+                                                chunk_size);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        voyager_data.flash_payload_offset = 0U;
+        voyager_data.lz_flushed_count += chunk_size;
+    }
+#else
+    (void)start_address;
+#endif  // VOYAGER_BOOTLOADER_LZ_WINDOW_BITS > 0
+    return ret;
+}
+
+voyager_error_E voyager_private_accumulate_dfu_crc(const voyager_bootloader_addr_size_t address, const uint8_t *const payload,
+                                                   const size_t length) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    if (voyager_data.config->readback_flash_during_dfu) {
+        // Read back only the region that was just written, in verify sized chunks
+        size_t offset = 0U;
+        while (offset < length) {
+            size_t chunk_size = length - offset;
+            if (chunk_size > sizeof(voyager_data.flash_read_buffer)) {
+                chunk_size = sizeof(voyager_data.flash_read_buffer);
+            }
+
+            ret = voyager_bootloader_hal_read_flash(address + offset, voyager_data.flash_read_buffer, chunk_size);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            voyager_private_calculate_crc_block(voyager_data.flash_read_buffer, chunk_size, &voyager_data.dfu_running_crc);
+            offset += chunk_size;
+        }
+    } else {
+        voyager_private_calculate_crc_block(payload, length, &voyager_data.dfu_running_crc);
+    }
+
+    return ret;
+}
+
+voyager_error_E voyager_private_verify_flash(bool *const result) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        ret = voyager_private_verify_flash_start();
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        bool complete = false;
+        ret = voyager_private_verify_flash_step(0U, &complete, result);
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_verify_flash_start(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_data.verify_in_progress = false;
+        voyager_bootloader_nvm_data_t data;
+
+        // Get the NVM key for the app CRC
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.verify_app_crc = data.app_crc;
+
+        // Get the NVM key for the app start address
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_START_ADDRESS, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.verify_app_start_address = data.app_start_address;
+
+        // Get the NVM key for the app size
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_SIZE, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+        voyager_data.verify_app_size = data.app_size;
+
+        voyager_data.verify_offset = 0U;
+        voyager_data.verify_crc = 0xffffffff;
+        voyager_data.verify_in_progress = true;
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_verify_flash_step(const voyager_bootloader_app_size_t max_bytes, bool *const complete,
+                                                  bool *const result) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        if (voyager_data.verify_in_progress == false) {
+            ret = VOYAGER_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        voyager_bootloader_app_size_t step_end = voyager_data.verify_app_size;
+        if ((max_bytes != 0U) && ((step_end - voyager_data.verify_offset) > max_bytes)) {
+            step_end = voyager_data.verify_offset + max_bytes;
+        }
+
+        // Iterate through the flash in chunks and calculate the CRC
+        while (voyager_data.verify_offset < step_end) {
+            size_t chunk_size = step_end - voyager_data.verify_offset;
+            if (chunk_size > sizeof(voyager_data.flash_read_buffer)) {
+                chunk_size = sizeof(voyager_data.flash_read_buffer);
+            }
+
+            ret = voyager_bootloader_hal_read_flash(voyager_data.verify_app_start_address + voyager_data.verify_offset,
+                                                    voyager_data.flash_read_buffer, chunk_size);
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+
+            voyager_private_calculate_crc_block(voyager_data.flash_read_buffer, chunk_size, &voyager_data.verify_crc);
+            voyager_data.verify_offset += chunk_size;
+        }
+
+        if (ret != VOYAGER_ERROR_NONE) {
+            voyager_data.verify_in_progress = false;
+            break;
+        }
+
+        *complete = (voyager_data.verify_offset == voyager_data.verify_app_size);
+        if (*complete) {
+            // Compare the calculated CRC to the stored CRC
+            voyager_data.verify_in_progress = false;
+            *result = (voyager_data.verify_crc == voyager_data.verify_app_crc);
+        }
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_verify_app(bool *const complete, bool *const result) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        const voyager_verify_policy_E policy = voyager_data.config->verify_policy;
+
+        if (voyager_data.verify_in_progress == false) {
+            bool skip_verification = false;
+
+            if (voyager_data.app_verified_during_dfu) {
+                // The image was already checked as it was written, skip re-reading it
+                *complete = true;
+                *result = true;
+                if (policy != VOYAGER_VERIFY_POLICY_ALWAYS) {
+                    ret = voyager_private_record_app_verified();
+                }
+                break;
+            }
+
+            if (policy != VOYAGER_VERIFY_POLICY_ALWAYS) {
+                voyager_bootloader_nvm_data_t data;
+                ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_CRC, &data);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+                const voyager_bootloader_app_crc_t app_crc = data.app_crc;
+
+                ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_VERIFIED_CRC, &data);
+                if (ret != VOYAGER_ERROR_NONE) {
+                    break;
+                }
+                const bool image_previously_verified = (data.app_verified_crc == app_crc);
+
+                if (policy == VOYAGER_VERIFY_POLICY_ONCE_AFTER_DFU) {
+                    skip_verification = image_previously_verified;
+                } else if (image_previously_verified) {
+                    ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY, &data);
+                    if (ret != VOYAGER_ERROR_NONE) {
+                        break;
+                    }
+
+                    if ((data.boots_since_verify + 1U) < voyager_data.config->verify_every_n_boots) {
+                        data.boots_since_verify++;
+                        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY, &data);
+                        if (ret != VOYAGER_ERROR_NONE) {
+                            break;
+                        }
+                        skip_verification = true;
+                    }
+                } else {
+                    // do nothing, the image has not been verified yet
+                }
+            }
+
+            if (skip_verification) {
+                *complete = true;
+                *result = true;
+                break;
+            }
+
+            // Also reached when the running DFU CRC mismatched, which the full verification will then reject
+            ret = voyager_private_verify_flash_start();
+            if (ret != VOYAGER_ERROR_NONE) {
+                break;
+            }
+        }
+
+        ret = voyager_private_verify_flash_step(voyager_data.config->verify_bytes_per_run, complete, result);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        if ((*complete) && (*result) && (policy != VOYAGER_VERIFY_POLICY_ALWAYS)) {
+            ret = voyager_private_record_app_verified();
+        }
+    } while (false);
+
+    return ret;
+}
+
+voyager_error_E voyager_private_record_app_verified(void) {
+    voyager_error_E ret = VOYAGER_ERROR_NONE;
+    do {
+        voyager_bootloader_nvm_data_t data;
+        ret = voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        data.app_verified_crc = data.app_crc;
+        ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_VERIFIED_CRC, &data);
+        if (ret != VOYAGER_ERROR_NONE) {
+            break;
+        }
+
+        if (voyager_data.config->verify_policy == VOYAGER_VERIFY_POLICY_EVERY_N_BOOTS) {
+            data.boots_since_verify = 0U;
+            ret = voyager_private_nvm_write(VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY, &data);
+        }
+    } while (false);
+
+    return ret;
+}
+
+void voyager_private_pack_crc_into_buffer(uint8_t buffer[4], const voyager_bootloader_app_crc_t crc) {
+    // memset the buffer to 0
+    memset(buffer, 0, 4);
     buffer[0] = (crc >> 24) & 0xFF;
     buffer[1] = (crc >> 16) & 0xFF;
     buffer[2] = (crc >> 8) & 0xFF;
@@ -643,22 +2201,85 @@ static const unsigned int crc32_table[] = {
     0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662, 0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06,
     0xa6322bdf, 0xa2f33668, 0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4};
 
-voyager_bootloader_app_crc_t voyager_private_calculate_crc(const void *buffer, const size_t app_size) {
-    size_t size = app_size;
+#if VOYAGER_BOOTLOADER_CRC_SLICES > 1
+// Slicing tables are generated from crc32_table on first use. Entry [k - 1][n] is the
+// CRC contribution of byte n followed by k zero bytes.
+static voyager_bootloader_app_crc_t crc32_slice_table[VOYAGER_BOOTLOADER_CRC_SLICES - 1][256];
+static bool crc32_slice_table_generated = false;
+
+static void voyager_private_generate_crc_slice_tables(void) {
+    for (size_t n = 0; n < 256; n++) {
+        voyager_bootloader_app_crc_t crc = crc32_table[n];
+        for (size_t k = 0; k < (VOYAGER_BOOTLOADER_CRC_SLICES - 1); k++) {
+            crc = (crc << 8) ^ crc32_table[crc >> 24];
+            crc32_slice_table[k][n] = crc;
+        }
+    }
+    crc32_slice_table_generated = true;
+}
+#endif  // VOYAGER_BOOTLOADER_CRC_SLICES > 1
 
-    const uint8_t *buf = (uint8_t *)buffer;
+static void voyager_private_calculate_crc_engine(const uint8_t *buf, size_t length, voyager_bootloader_app_crc_t *const crc) {
+    voyager_bootloader_app_crc_t calculated_crc = *crc;
 
-    voyager_bootloader_app_crc_t calculated_crc = 0xffffffff;
-    while (size--) {
-        voyager_private_calculate_crc_stream(*buf, &calculated_crc);
+#if VOYAGER_BOOTLOADER_CRC_SLICES > 1
+    if (crc32_slice_table_generated == false) {
+        voyager_private_generate_crc_slice_tables();
+    }
+
+    // Bytes are assembled MSB first so the result is independent of alignment and endianness
+    while (length >= VOYAGER_BOOTLOADER_CRC_SLICES) {
+        const voyager_bootloader_app_crc_t word = calculated_crc ^ (((voyager_bootloader_app_crc_t)buf[0] << 24) |
+                                                                    ((voyager_bootloader_app_crc_t)buf[1] << 16) |
+                                                                    ((voyager_bootloader_app_crc_t)buf[2] << 8) | buf[3]);
+#if VOYAGER_BOOTLOADER_CRC_SLICES == 8
+        calculated_crc = crc32_slice_table[6][word >> 24] ^ crc32_slice_table[5][(word >> 16) & 255] ^
+                         crc32_slice_table[4][(word >> 8) & 255] ^ crc32_slice_table[3][word & 255] ^
+                         crc32_slice_table[2][buf[4]] ^ crc32_slice_table[1][buf[5]] ^ crc32_slice_table[0][buf[6]] ^
+                         crc32_table[buf[7]];
+#else
+        calculated_crc = crc32_slice_table[2][word >> 24] ^ crc32_slice_table[1][(word >> 16) & 255] ^
+                         crc32_slice_table[0][(word >> 8) & 255] ^ crc32_table[word & 255];
+#endif  // VOYAGER_BOOTLOADER_CRC_SLICES == 8
+        buf += VOYAGER_BOOTLOADER_CRC_SLICES;
+        length -= VOYAGER_BOOTLOADER_CRC_SLICES;
+    }
+#endif  // VOYAGER_BOOTLOADER_CRC_SLICES > 1
+
+    // Process any remaining bytes one at a time
+    while (length--) {
+        calculated_crc = (calculated_crc << 8) ^ crc32_table[((calculated_crc >> 24) ^ *buf) & 255];
         buf++;
     }
 
+    *crc = calculated_crc;
+}
+
+voyager_bootloader_app_crc_t voyager_private_calculate_crc(const void *buffer, const size_t app_size) {
+    voyager_bootloader_app_crc_t calculated_crc = 0xffffffff;
+    voyager_private_calculate_crc_block(buffer, app_size, &calculated_crc);
+
     return calculated_crc;
 }
 
+void voyager_private_calculate_crc_block(const void *buffer, const size_t length, voyager_bootloader_app_crc_t *const crc) {
+    const uint8_t *buf = (const uint8_t *)buffer;
+
+    if (voyager_data.config->custom_crc_block != NULL) {
+        voyager_data.config->custom_crc_block(buf, length, crc);
+    } else if (voyager_data.config->custom_crc_stream != NULL) {
+        for (size_t i = 0; i < length; i++) {
+            voyager_data.config->custom_crc_stream(buf[i], crc);
+        }
+    } else {
+        voyager_private_calculate_crc_engine(buf, length, crc);
+    }
+}
+
 void voyager_private_calculate_crc_stream(const uint8_t byte, voyager_bootloader_app_crc_t *const crc) {
-    if (voyager_data.config->custom_crc_stream != NULL) {
+    if (voyager_data.config->custom_crc_block != NULL) {
+        voyager_data.config->custom_crc_block(&byte, 1U, crc);
+    } else if (voyager_data.config->custom_crc_stream != NULL) {
         voyager_data.config->custom_crc_stream(byte, crc);
     } else {
         *crc = (*crc << 8) ^ crc32_table[(((*crc) >> 24) ^ byte) & 255];
@@ -0,0 +1,41 @@
+/**
+ * @file bench.hpp
+ * @brief Benchmarks run by `make bench`, and helpers shared between them
+ */
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @brief Times a function and converts the time taken into a rate
+ * @param function The function to time
+ * @param bytes The number of bytes the function processes per call
+ * @param iterations The number of times to call the function
+ * @return the rate in MiB/s
+ */
+template <typename F>
+static inline double time_mib_per_second(F function, size_t bytes, size_t iterations) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        function();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)(bytes * iterations) / (1024.0 * 1024.0) / elapsed.count();
+}
+
+/**
+ * @brief Compares the byte-wise CRC path against the block CRC engine
+ * @return 0 if both produce the same CRC, otherwise 1
+ */
+int bench_crc(void);
+
+/**
+ * @brief Compares a plain DFU transfer against a compressed one over a slow serial link
+ * @return 0 if both transfers write the image intact, otherwise 1
+ */
+int bench_compression(void);
+
+#endif  // BENCH_HPP
@@ -0,0 +1,139 @@
+/**
+ * @file bench_compression.cpp
+ * @brief Benchmark of the effective DFU throughput of compressed transfers against plain ones over a serial link
+ *
+ * Build and run with `make bench`
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "voyager_host_message_generator.h"
+
+extern "C" {
+#include "voyager.h"
+#include "voyager_private.h"
+}
+
+/// @brief Baud rate of the modelled UART link, 10 bits on the wire per byte
+static const double LINK_BAUD_RATE = 115200.0;
+
+/// @brief Outcome of a DFU transfer through the library
+struct transfer_result {
+    /// @brief Bytes sent to the target, packet headers included, plus the ACKs sent back
+    size_t wire_bytes;
+    /// @brief Time the target spent processing the transfer
+    double target_seconds;
+    /// @brief Whether the image reached flash intact
+    bool intact;
+};
+
+// Builds an image resembling firmware: code drawn from a small instruction vocabulary mixed with unique
+// constants, followed by erased padding at the end of the partition
+static std::vector<uint8_t> make_firmware_image(size_t image_size) {
+    std::vector<uint8_t> image(image_size, 0xFFU);
+    uint32_t state = 0x12345678U;
+    auto next_random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    uint8_t vocabulary[64][4];
+    for (auto &instruction : vocabulary) {
+        for (auto &byte : instruction) {
+            byte = (uint8_t)next_random();
+        }
+    }
+
+    const size_t code_size = image_size - (image_size / 8U);
+    for (size_t i = 0; i + 4U <= code_size; i += 4U) {
+        const uint32_t choice = next_random();
+        for (size_t byte = 0; byte < 4U; byte++) {
+            image[i + byte] = ((choice % 100U) < 70U) ? vocabulary[(choice >> 8) % 64U][byte] : (uint8_t)next_random();
+        }
+    }
+
+    return image;
+}
+
+// Sends a stream to the target in full DATA packets, one at a time
+static transfer_result run_transfer(const std::vector<uint8_t> &image, const std::vector<uint8_t> &stream, bool compressed) {
+    static const voyager_bootloader_config_t config = {
+        .verify_crc_during_dfu = true,
+    };
+    static const size_t ack_size = 8U;
+    uint8_t packet[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    transfer_result result = {0U, 0.0, false};
+
+    voyager_bootloader_init(&config);
+    voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU);
+    const uint32_t app_crc = voyager_host_calculate_crc(image.data(), image.size());
+    size_t packet_size = 8U;
+    if (compressed) {
+        packet_size = 12U;
+        voyager_host_message_generator_generate_compressed_start_request(packet, sizeof(packet), image.size(), app_crc, 1U, 1U,
+                                                                         VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+    } else {
+        voyager_host_message_generator_generate_start_request(packet, sizeof(packet), image.size(), app_crc);
+    }
+    voyager_bootloader_process_receieved_packet(packet, packet_size);
+    voyager_bootloader_run();
+    voyager_bootloader_run();
+    result.wire_bytes += packet_size + ack_size;
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t sent_size = 0U;
+    uint8_t sequence_number = 0U;
+    while (sent_size < stream.size()) {
+        size_t payload_size = sizeof(packet) - 2U;
+        if (payload_size > stream.size() - sent_size) {
+            payload_size = stream.size() - sent_size;
+        }
+        packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet, sizeof(packet), &stream[sent_size], payload_size, sequence_number++);
+        voyager_bootloader_process_receieved_packet(packet, packet_size);
+        voyager_bootloader_run();
+        result.wire_bytes += packet_size + ack_size;
+        sent_size += payload_size;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.target_seconds = elapsed.count();
+
+    result.intact = (voyager_private_get_data()->bytes_written == image.size()) &&
+                    voyager_private_get_data()->app_verified_during_dfu;
+    return result;
+}
+
+static void print_transfer(const char *const name, size_t image_size, const transfer_result &result) {
+    const double link_seconds = (double)result.wire_bytes * 10.0 / LINK_BAUD_RATE;
+    const double total_seconds = link_seconds + result.target_seconds;
+    printf("%-11s %8zu bytes on the wire, %7.2f s, %6.2f KiB/s effective, target %8.1f MiB/s%s\n", name, result.wire_bytes,
+           total_seconds, (double)image_size / 1024.0 / total_seconds,
+           (double)image_size / (1024.0 * 1024.0) / result.target_seconds, result.intact ? "" : " (CORRUPT)");
+}
+
+int bench_compression(void) {
+    // 128 KiB image, kept small as the host compressor searches its window by brute force
+    static const size_t image_size = 128U * 1024U;
+    const std::vector<uint8_t> image = make_firmware_image(image_size);
+
+    std::vector<uint8_t> stream(image_size + (image_size / 8U) + 1U);
+    const size_t stream_size =
+        voyager_host_lz_compress(image.data(), image.size(), stream.data(), stream.size(), VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+    stream.resize(stream_size);
+
+    const transfer_result plain = run_transfer(image, image, false);
+    const transfer_result compressed = run_transfer(image, stream, true);
+
+    printf("DFU over a %.0f baud link, %u byte decompression window\n", LINK_BAUD_RATE,
+           1U << VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+    printf("compressed stream: %zu of %zu bytes (%.1f%%)\n", stream_size, image_size,
+           100.0 * (double)stream_size / (double)image_size);
+    print_transfer("plain:", image_size, plain);
+    print_transfer("compressed:", image_size, compressed);
+
+    return (plain.intact && compressed.intact) ? 0 : 1;
+}
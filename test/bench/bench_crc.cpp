@@ -0,0 +1,63 @@
+/**
+ * @file bench_crc.cpp
+ * @brief Benchmark of the byte-wise CRC path against the block CRC engine
+ *
+ * Build and run with `make bench`
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+
+extern "C" {
+#include "voyager.h"
+#include "voyager_private.h"
+}
+
+int bench_crc(void) {
+    static const voyager_bootloader_config_t config = {
+        .jump_to_app_after_dfu_recv_complete = false,
+        .custom_crc_stream = NULL,
+        .custom_crc_block = NULL,
+    };
+    voyager_bootloader_init(&config);
+
+    // 512 KiB image, the size of a typical application partition
+    static const size_t image_size = 512U * 1024U;
+    static const size_t iterations = 20U;
+    std::vector<uint8_t> image(image_size);
+    for (size_t i = 0; i < image_size; i++) {
+        image[i] = (uint8_t)((i * 2654435761U) >> 24);
+    }
+
+    volatile voyager_bootloader_app_crc_t sink = 0;
+    voyager_bootloader_app_crc_t byte_wise_crc = 0;
+    voyager_bootloader_app_crc_t block_crc = 0;
+
+    const double byte_wise_rate = time_mib_per_second(
+        [&]() {
+            voyager_bootloader_app_crc_t crc = 0xffffffff;
+            for (size_t i = 0; i < image_size; i++) {
+                voyager_private_calculate_crc_stream(image[i], &crc);
+            }
+            byte_wise_crc = crc;
+            sink = crc;
+        },
+        image_size, iterations);
+
+    const double block_rate = time_mib_per_second(
+        [&]() {
+            block_crc = voyager_private_calculate_crc(image.data(), image_size);
+            sink = block_crc;
+        },
+        image_size, iterations);
+    (void)sink;
+
+    printf("CRC engine: slicing-by-%d\n", VOYAGER_BOOTLOADER_CRC_SLICES);
+    printf("byte-wise: %10.1f MiB/s (crc 0x%08x)\n", byte_wise_rate, (unsigned)byte_wise_crc);
+    printf("block:     %10.1f MiB/s (crc 0x%08x)\n", block_rate, (unsigned)block_crc);
+    printf("speedup:   %10.2fx\n", block_rate / byte_wise_rate);
+
+    return (byte_wise_crc == block_crc) ? 0 : 1;
+}
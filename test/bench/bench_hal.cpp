@@ -0,0 +1,61 @@
+/**
+ * @file bench_hal.cpp
+ * @brief Stubbed bootloader HAL shared by the benchmarks
+ */
+
+#include <cstring>
+
+extern "C" {
+#include "voyager.h"
+}
+
+// The port hook the unit tests use to interleave the receive queue, a plain fence here
+extern "C" void mock_dfu_memory_barrier(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+// The bootloader's user implemented functions do no work, so the benchmarks time the library alone
+voyager_error_E voyager_bootloader_send_to_host(void const *const data, size_t len) {
+    (void)data;
+    (void)len;
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_nvm_write(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t const *const data) {
+    (void)key;
+    (void)data;
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_nvm_read(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t *const data) {
+    (void)key;
+    // Every key reads as zero, which places the application at address 0 of the stubbed flash
+    memset(data, 0, sizeof(*data));
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_hal_erase_flash(const voyager_bootloader_addr_size_t start_address,
+                                                   const voyager_bootloader_addr_size_t end_address) {
+    (void)start_address;
+    (void)end_address;
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_hal_write_flash(const voyager_bootloader_addr_size_t address, void const *const data,
+                                                   size_t const length) {
+    (void)address;
+    (void)data;
+    (void)length;
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_hal_read_flash(const voyager_bootloader_addr_size_t address, void *const data,
+                                                  size_t const length) {
+    (void)address;
+    (void)data;
+    (void)length;
+    return VOYAGER_ERROR_NONE;
+}
+
+voyager_error_E voyager_bootloader_hal_jump_to_app(const voyager_bootloader_addr_size_t app_start_address) {
+    (void)app_start_address;
+    return VOYAGER_ERROR_NONE;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file bench_main.cpp
+ * @brief Runs every benchmark
+ *
+ * Build and run with `make bench`
+ */
+
+#include <cstdio>
+
+#include "bench.hpp"
+
+int main(void) {
+    int ret = bench_crc();
+    printf("\n");
+    ret |= bench_compression();
+    return ret;
+}
@@ -1,4 +1,8 @@
 #ifndef VOYAGER_CFGPORT_H
 #define VOYAGER_CFGPORT_H
 
+// Lets tests act as the transport interrupt at the exact points the receive queue is handed over
+void mock_dfu_memory_barrier(void);
+#define VOYAGER_BOOTLOADER_MEMORY_BARRIER() mock_dfu_memory_barrier()
+
 #endif  // VOYAGER_CFGPORT_H
@@ -5,5 +5,7 @@ IMPORT_TEST_GROUP(dummy_test);
 IMPORT_TEST_GROUP(test_bootloader_state_machine);
 IMPORT_TEST_GROUP(test_dfu);
 IMPORT_TEST_GROUP(test_bootloader_api);
+IMPORT_TEST_GROUP(test_crc);
+IMPORT_TEST_GROUP(test_rx_queue);
 
 int main(int ac, char **av) { return CommandLineTestRunner::RunAllTests(ac, av); }
\ No newline at end of file
@@ -6,6 +6,27 @@
 #include "voyager_private.h"
 
 static uint8_t fake_flash[FAKE_FLASH_SIZE] = {0};
+// Second region, used as the staging area of delta updates
+static uint8_t fake_staging_flash[FAKE_FLASH_SIZE] = {0};
+static size_t read_flash_call_count = 0U;
+static size_t send_to_host_call_count = 0U;
+static size_t write_flash_call_count = 0U;
+static size_t erase_flash_call_count = 0U;
+static bool flash_emulation_enabled = false;
+static bool async_flash_enabled = false;
+
+// The flash operation the simulated slow flash is working on
+static struct {
+    bool pending;
+    bool is_erase;
+    voyager_bootloader_addr_size_t address;
+    voyager_bootloader_addr_size_t end_address;
+    void const *data;
+    size_t length;
+} async_flash_op;
+static uint8_t last_sent_message[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+static size_t last_sent_message_len = 0U;
+static void (*memory_barrier_hook)(void) = NULL;
 
 voyager_error_E voyager_bootloader_hal_jump_to_app(const voyager_bootloader_addr_size_t app_start_address) {
     mock_c()
@@ -18,38 +39,159 @@ voyager_error_E voyager_bootloader_hal_jump_to_app(const voyager_bootloader_addr
 void mock_dfu_init(void) {
     // memcpy the fake flash data 0 to fake_flash
     memcpy(fake_flash, fake_flash_data_0, FAKE_FLASH_SIZE);
+    memset(fake_staging_flash, 0, FAKE_FLASH_SIZE);
+    read_flash_call_count = 0U;
+    send_to_host_call_count = 0U;
+    write_flash_call_count = 0U;
+    erase_flash_call_count = 0U;
+    flash_emulation_enabled = false;
+    async_flash_enabled = false;
+    async_flash_op.pending = false;
+    last_sent_message_len = 0U;
+    memory_barrier_hook = NULL;
+}
+
+void mock_dfu_memory_barrier(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (memory_barrier_hook != NULL) {
+        memory_barrier_hook();
+    }
 }
 
+void mock_dfu_set_memory_barrier_hook(void (*hook)(void)) { memory_barrier_hook = hook; }
+
 uint8_t *mock_dfu_get_flash(void) { return fake_flash; }
 
+uint8_t *mock_dfu_get_staging_flash(void) { return fake_staging_flash; }
+
+size_t mock_dfu_get_read_flash_call_count(void) { return read_flash_call_count; }
+
+size_t mock_dfu_get_send_to_host_call_count(void) { return send_to_host_call_count; }
+
+size_t mock_dfu_get_write_flash_call_count(void) { return write_flash_call_count; }
+
+size_t mock_dfu_get_erase_flash_call_count(void) { return erase_flash_call_count; }
+
+void mock_dfu_enable_flash_emulation(const bool enable) { flash_emulation_enabled = enable; }
+
+void mock_dfu_enable_async_flash(const bool enable) { async_flash_enabled = enable; }
+
+// Clamps [start_address, end_address) to a fake flash region, returning false if they do not overlap
+static bool mock_dfu_clamp_to_flash(const uint8_t *const region, voyager_bootloader_addr_size_t *const start_address,
+                                    voyager_bootloader_addr_size_t *const end_address) {
+    const voyager_bootloader_addr_size_t flash_start = (uintptr_t)region;
+    const voyager_bootloader_addr_size_t flash_end = flash_start + FAKE_FLASH_SIZE;
+    if (*start_address < flash_start) {
+        *start_address = flash_start;
+    }
+    if (*end_address > flash_end) {
+        *end_address = flash_end;
+    }
+    return *start_address < *end_address;
+}
+
+const uint8_t *mock_dfu_get_last_sent_message(size_t *const len) {
+    *len = last_sent_message_len;
+    return last_sent_message;
+}
+
 voyager_error_E voyager_bootloader_send_to_host(void const *const data, size_t len) {
+    // Record the message so tests can inspect it even when the mock is disabled
+    send_to_host_call_count++;
+    last_sent_message_len = (len < sizeof(last_sent_message)) ? len : sizeof(last_sent_message);
+    memcpy(last_sent_message, data, last_sent_message_len);
+
     mock_c()->actualCall("voyager_bootloader_send_to_host")->withMemoryBufferParameter("data", data, len);
 
     return (voyager_error_E)mock_c()->returnValue().value.intValue;
 }
 
+static void mock_dfu_emulate_erase(const voyager_bootloader_addr_size_t start_address,
+                                   const voyager_bootloader_addr_size_t end_address) {
+    uint8_t *const regions[] = {fake_flash, fake_staging_flash};
+    for (size_t i = 0; flash_emulation_enabled && (i < (sizeof(regions) / sizeof(regions[0]))); i++) {
+        voyager_bootloader_addr_size_t erase_start = start_address;
+        voyager_bootloader_addr_size_t erase_end = end_address;
+        if (mock_dfu_clamp_to_flash(regions[i], &erase_start, &erase_end)) {
+            memset(&regions[i][erase_start - (uintptr_t)regions[i]], 0xFF, erase_end - erase_start);
+        }
+    }
+}
+
+static void mock_dfu_emulate_write(const voyager_bootloader_addr_size_t address, void const *const data, size_t const length) {
+    uint8_t *const regions[] = {fake_flash, fake_staging_flash};
+    for (size_t i = 0; flash_emulation_enabled && (i < (sizeof(regions) / sizeof(regions[0]))); i++) {
+        voyager_bootloader_addr_size_t write_start = address;
+        voyager_bootloader_addr_size_t write_end = address + length;
+        if (mock_dfu_clamp_to_flash(regions[i], &write_start, &write_end)) {
+            memcpy(&regions[i][write_start - (uintptr_t)regions[i]], (const uint8_t *)data + (write_start - address),
+                   write_end - write_start);
+        }
+    }
+}
+
+bool mock_dfu_flash_op_pending(void) { return async_flash_op.pending; }
+
+voyager_error_E mock_dfu_complete_flash_op(const voyager_error_E result) {
+    // Like a DMA transfer, the data is only read from the caller's buffer when the operation completes
+    if (async_flash_op.pending && (result == VOYAGER_ERROR_NONE)) {
+        if (async_flash_op.is_erase) {
+            mock_dfu_emulate_erase(async_flash_op.address, async_flash_op.end_address);
+        } else {
+            mock_dfu_emulate_write(async_flash_op.address, async_flash_op.data, async_flash_op.length);
+        }
+    }
+    async_flash_op.pending = false;
+
+    return voyager_bootloader_hal_op_complete(result);
+}
+
 voyager_error_E voyager_bootloader_hal_erase_flash(const voyager_bootloader_addr_size_t start_address,
                                                    const voyager_bootloader_addr_size_t end_address) {
+    erase_flash_call_count++;
+
     mock_c()
         ->actualCall("voyager_bootloader_hal_erase_flash")
         ->withUnsignedLongIntParameters("start_address", start_address)
         ->withUnsignedLongIntParameters("end_address", end_address);
 
+    if (async_flash_enabled) {
+        async_flash_op.pending = true;
+        async_flash_op.is_erase = true;
+        async_flash_op.address = start_address;
+        async_flash_op.end_address = end_address;
+        return VOYAGER_ERROR_BUSY;
+    }
+
+    mock_dfu_emulate_erase(start_address, end_address);
     return (voyager_error_E)mock_c()->returnValue().value.intValue;
 }
 
 voyager_error_E voyager_bootloader_hal_write_flash(const voyager_bootloader_addr_size_t address, void const *const data,
                                                    size_t const length) {
+    write_flash_call_count++;
+
     mock_c()
         ->actualCall("voyager_bootloader_hal_write_flash")
         ->withUnsignedLongIntParameters("address", address)
         ->withMemoryBufferParameter("data", data, length);
 
+    if (async_flash_enabled) {
+        async_flash_op.pending = true;
+        async_flash_op.is_erase = false;
+        async_flash_op.address = address;
+        async_flash_op.data = data;
+        async_flash_op.length = length;
+        return VOYAGER_ERROR_BUSY;
+    }
+
+    mock_dfu_emulate_write(address, data, length);
     return (voyager_error_E)mock_c()->returnValue().value.intValue;
 }
 
 voyager_error_E voyager_bootloader_hal_read_flash(const voyager_bootloader_addr_size_t address, void *const data,
                                                   size_t const length) {
+    read_flash_call_count++;
     // make a const pointer to the address
     const uint8_t *const flash = (const uint8_t *const)address;
     // copy the data from the flash to the data pointer
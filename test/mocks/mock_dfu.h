@@ -1,6 +1,10 @@
 #ifndef MOCK_DFU_H
 #define MOCK_DFU_H
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
+
+#include "voyager.h"
 
 #define FAKE_FLASH_SIZE (129U)
 
@@ -16,4 +20,32 @@ void mock_dfu_init(void);
 
 uint8_t *mock_dfu_get_flash(void);
 
+// Emulated like the fake flash, for tests that need a second flash region
+uint8_t *mock_dfu_get_staging_flash(void);
+
+size_t mock_dfu_get_read_flash_call_count(void);
+
+size_t mock_dfu_get_send_to_host_call_count(void);
+
+size_t mock_dfu_get_write_flash_call_count(void);
+
+size_t mock_dfu_get_erase_flash_call_count(void);
+
+// When enabled, erases and writes that fall inside the fake flash modify it like real flash would
+void mock_dfu_enable_flash_emulation(const bool enable);
+
+// When enabled, erases and writes return VOYAGER_ERROR_BUSY and only take effect once mock_dfu_complete_flash_op is
+// called, simulating a slow flash driven by interrupts
+void mock_dfu_enable_async_flash(const bool enable);
+
+bool mock_dfu_flash_op_pending(void);
+
+voyager_error_E mock_dfu_complete_flash_op(const voyager_error_E result);
+
+const uint8_t *mock_dfu_get_last_sent_message(size_t *const len);
+
+// Calls hook after every receive queue memory barrier until it is cleared, e.g. to commit a packet part way through
+// voyager_bootloader_run as an interrupt would. Cleared by mock_dfu_init
+void mock_dfu_set_memory_barrier_hook(void (*hook)(void));
+
 #endif  // MOCK_DFU_H
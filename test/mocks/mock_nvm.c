@@ -24,6 +24,21 @@ voyager_error_E voyager_bootloader_nvm_write(const voyager_nvm_key_E key, voyage
         case VOYAGER_NVM_KEY_APP_END_ADDRESS: {
             mock_nvm_data.app_end_address = data->app_end_address;
         } break;
+        case VOYAGER_NVM_KEY_APP_VERIFIED_CRC: {
+            mock_nvm_data.app_verified_crc = data->app_verified_crc;
+        } break;
+        case VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY: {
+            mock_nvm_data.boots_since_verify = data->boots_since_verify;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION: {
+            mock_nvm_data.dfu_checkpoint_session = data->dfu_checkpoint_session;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_OFFSET: {
+            mock_nvm_data.dfu_checkpoint_offset = data->dfu_checkpoint_offset;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC: {
+            mock_nvm_data.dfu_checkpoint_crc = data->dfu_checkpoint_crc;
+        } break;
         default: {
             error = VOYAGER_ERROR_INVALID_ARGUMENT;
         } break;
@@ -34,6 +49,7 @@ voyager_error_E voyager_bootloader_nvm_write(const voyager_nvm_key_E key, voyage
 
 voyager_error_E voyager_bootloader_nvm_read(const voyager_nvm_key_E key, voyager_bootloader_nvm_data_t *const data) {
     voyager_error_E error = mock_nvm_data.read_error;
+    mock_nvm_data.read_call_count++;
     switch (key) {
         case VOYAGER_NVM_KEY_APP_SIZE: {
             data->app_size = mock_nvm_data.app_size;
@@ -47,6 +63,21 @@ voyager_error_E voyager_bootloader_nvm_read(const voyager_nvm_key_E key, voyager
         case VOYAGER_NVM_KEY_APP_END_ADDRESS: {
             data->app_end_address = mock_nvm_data.app_end_address;
         } break;
+        case VOYAGER_NVM_KEY_APP_VERIFIED_CRC: {
+            data->app_verified_crc = mock_nvm_data.app_verified_crc;
+        } break;
+        case VOYAGER_NVM_KEY_BOOTS_SINCE_VERIFY: {
+            data->boots_since_verify = mock_nvm_data.boots_since_verify;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_SESSION: {
+            data->dfu_checkpoint_session = mock_nvm_data.dfu_checkpoint_session;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_OFFSET: {
+            data->dfu_checkpoint_offset = mock_nvm_data.dfu_checkpoint_offset;
+        } break;
+        case VOYAGER_NVM_KEY_DFU_CHECKPOINT_CRC: {
+            data->dfu_checkpoint_crc = mock_nvm_data.dfu_checkpoint_crc;
+        } break;
         default: {
             error = VOYAGER_ERROR_INVALID_ARGUMENT;
         } break;
@@ -9,6 +9,12 @@ typedef struct {
     voyager_bootloader_addr_size_t app_start_address;
     voyager_bootloader_addr_size_t app_end_address;
     voyager_bootloader_app_size_t app_size;
+    voyager_bootloader_app_crc_t app_verified_crc;
+    voyager_bootloader_boot_count_t boots_since_verify;
+    uint32_t dfu_checkpoint_session;
+    voyager_bootloader_app_size_t dfu_checkpoint_offset;
+    voyager_bootloader_app_crc_t dfu_checkpoint_crc;
+    size_t read_call_count;
 } mock_nvm_data_t;
 
 mock_nvm_data_t *mock_nvm_get_data(void);
@@ -54,3 +54,40 @@ TEST(test_bootloader_api, test_custom_crc_implementation) {
     voyager_private_calculate_crc_stream(1, &test_crc);
     CHECK_EQUAL(test_crc_constant, test_crc);
 }
+
+static size_t custom_crc_block_call_count = 0U;
+static size_t custom_crc_block_bytes = 0U;
+
+void custom_crc_block_implementation(const uint8_t *const data, const size_t length, voyager_bootloader_app_crc_t *const crc) {
+    (void)data;
+    custom_crc_block_call_count++;
+    custom_crc_block_bytes += length;
+    *crc = test_crc_constant;
+}
+
+// Test that a custom block CRC implementation is handed whole buffers and takes precedence over the stream function
+TEST(test_bootloader_api, test_custom_crc_block_implementation) {
+    voyager_bootloader_config_t config_custom_crc{.jump_to_app_after_dfu_recv_complete = true,
+                                                  .custom_crc_stream = custom_crc_implementation,
+                                                  .custom_crc_block = custom_crc_block_implementation};
+
+    voyager_bootloader_init(&config_custom_crc);
+    custom_crc_block_call_count = 0U;
+    custom_crc_block_bytes = 0U;
+
+    uint8_t buffer[40] = {0};
+    CHECK_EQUAL(test_crc_constant, voyager_private_calculate_crc(buffer, sizeof(buffer)));
+    CHECK_EQUAL(1U, custom_crc_block_call_count);
+    CHECK_EQUAL(sizeof(buffer), custom_crc_block_bytes);
+
+    // Flash verification feeds the callback one chunk at a time
+    custom_crc_block_call_count = 0U;
+    custom_crc_block_bytes = 0U;
+    mock_nvm_get_data()->app_crc = test_crc_constant;
+    bool flash_verified = false;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_verify_flash(&flash_verified));
+    CHECK_EQUAL(true, flash_verified);
+    CHECK_EQUAL((FAKE_FLASH_SIZE + VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE - 1) / VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE,
+                custom_crc_block_call_count);
+    CHECK_EQUAL(FAKE_FLASH_SIZE, custom_crc_block_bytes);
+}
@@ -108,3 +108,160 @@ TEST(test_bootloader_state_machine, test_app_good_crc_verify) {
     // Ensure that the voyager data request is set to VOYAGER_REQUEST_KEEP_IDLE
     CHECK_EQUAL(VOYAGER_REQUEST_KEEP_IDLE, voyager_private_get_data()->request);
 }
+
+// Test that flash verification reads the application in chunks rather than one byte at a time
+TEST(test_bootloader_state_machine, test_verify_flash_reads_in_chunks) {
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+
+    bool flash_verified = false;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_verify_flash(&flash_verified));
+    CHECK_EQUAL(true, flash_verified);
+
+    // The final chunk is a partial one as the app size is not a multiple of the chunk size
+    const size_t expected_reads =
+        (FAKE_FLASH_SIZE + VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE - 1) / VOYAGER_BOOTLOADER_VERIFY_CHUNK_SIZE;
+    CHECK_EQUAL(expected_reads, mock_dfu_get_read_flash_call_count());
+
+    // A corrupted final byte must still be caught by the partial chunk
+    mock_dfu_get_flash()[FAKE_FLASH_SIZE - 1] ^= 0xFF;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_verify_flash(&flash_verified));
+    CHECK_EQUAL(false, flash_verified);
+}
+
+// Boots with the given config, requests a jump to the app and checks whether the application flash was read
+static void boot_and_jump(const voyager_bootloader_config_t *const config, bool expect_flash_read) {
+    mock_dfu_init();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_JUMP_TO_APP));
+
+    mock()
+        .expectOneCall("voyager_bootloader_hal_jump_to_app")
+        .withParameter("app_start_address", mock_nvm_get_data()->app_start_address)
+        .andReturnValue(VOYAGER_ERROR_NONE);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().checkExpectations();
+    mock().clear();
+
+    CHECK_EQUAL(expect_flash_read, mock_dfu_get_read_flash_call_count() != 0U);
+}
+
+// Test that the verify once policy only reads the application flash on the first boot of a new image
+TEST(test_bootloader_state_machine, test_verify_policy_once_after_dfu) {
+    static const voyager_bootloader_config_t verify_once_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_policy = VOYAGER_VERIFY_POLICY_ONCE_AFTER_DFU,
+    };
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+    nvm_data->app_verified_crc = ~nvm_data->app_crc;
+
+    boot_and_jump(&verify_once_config, true);
+    CHECK_EQUAL(nvm_data->app_crc, nvm_data->app_verified_crc);
+
+    boot_and_jump(&verify_once_config, false);
+    boot_and_jump(&verify_once_config, false);
+
+    // Starting a DFU invalidates the verified marker
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&verify_once_config));
+    voyager_message_t start_message = {0};
+    start_message.header.message_id = VOYAGER_MESSAGE_ID_START;
+    start_message.message_payload.start_packet_data.app_size = FAKE_FLASH_SIZE;
+    start_message.message_payload.start_packet_data.app_crc = nvm_data->app_crc;
+    // The start packet ACK is computed over the raw queued message
+    const uint8_t raw_start_message[8] = {0};
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(raw_start_message, sizeof(raw_start_message)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_process_start_packet(&start_message));
+    CHECK(nvm_data->app_crc != nvm_data->app_verified_crc);
+
+    boot_and_jump(&verify_once_config, true);
+}
+
+// Test that the every N boots policy reads the application flash on every Nth boot
+TEST(test_bootloader_state_machine, test_verify_policy_every_n_boots) {
+    static const voyager_bootloader_config_t verify_every_n_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_policy = VOYAGER_VERIFY_POLICY_EVERY_N_BOOTS,
+        .verify_every_n_boots = 3U,
+    };
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+    nvm_data->app_verified_crc = ~nvm_data->app_crc;
+    nvm_data->boots_since_verify = 0U;
+
+    for (size_t boot = 0; boot < 7U; boot++) {
+        boot_and_jump(&verify_every_n_config, (boot % 3U) == 0U);
+    }
+}
+
+// Test that an image that fails verification is never marked as verified
+TEST(test_bootloader_state_machine, test_verify_policy_bad_crc_is_not_recorded) {
+    static const voyager_bootloader_config_t verify_once_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_policy = VOYAGER_VERIFY_POLICY_ONCE_AFTER_DFU,
+    };
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE) + 1;
+    nvm_data->app_verified_crc = ~nvm_data->app_crc;
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&verify_once_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_JUMP_TO_APP));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_private_get_desired_state());
+    CHECK(nvm_data->app_crc != nvm_data->app_verified_crc);
+}
+
+// Test that a bounded verification is spread across several runs before jumping to the app
+TEST(test_bootloader_state_machine, test_verify_time_sliced_across_runs) {
+    static const voyager_bootloader_config_t time_sliced_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_bytes_per_run = 40U,
+    };
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&time_sliced_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_JUMP_TO_APP));
+
+    // 129 bytes at 40 bytes per run takes 4 runs, the first 3 of which stay in the jump state without jumping
+    for (size_t run = 0; run < 3U; run++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        CHECK_EQUAL(VOYAGER_STATE_JUMP_TO_APP, voyager_bootloader_get_state());
+        CHECK_EQUAL(true, voyager_private_get_data()->verify_in_progress);
+        CHECK_EQUAL((run + 1U) * 40U, voyager_private_get_data()->verify_offset);
+    }
+
+    mock()
+        .expectOneCall("voyager_bootloader_hal_jump_to_app")
+        .withParameter("app_start_address", nvm_data->app_start_address)
+        .andReturnValue(VOYAGER_ERROR_NONE);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().checkExpectations();
+
+    CHECK_EQUAL(false, voyager_private_get_data()->verify_in_progress);
+    // Each 40 byte slice is read as 16 + 16 + 8 bytes, and the final byte in one read
+    CHECK_EQUAL(10U, mock_dfu_get_read_flash_call_count());
+}
+
+// Test that a time sliced verification still rejects a bad image
+TEST(test_bootloader_state_machine, test_verify_time_sliced_bad_crc) {
+    static const voyager_bootloader_config_t time_sliced_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_bytes_per_run = 64U,
+    };
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    nvm_data->app_crc = voyager_private_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE) + 1;
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&time_sliced_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_JUMP_TO_APP));
+
+    for (size_t run = 0; run < 3U; run++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    }
+
+    CHECK_EQUAL(true, voyager_private_get_data()->app_failed_crc_check);
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_private_get_desired_state());
+}
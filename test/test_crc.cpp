@@ -0,0 +1,55 @@
+#include "CppUTest/TestHarness.h"
+#include "test_defaults.hpp"
+
+extern "C" {
+#include "voyager.h"
+#include "voyager_private.h"
+}
+
+extern const voyager_bootloader_config_t default_test_config;
+
+// create a test group
+TEST_GROUP(test_crc){void setup(){voyager_bootloader_init(&default_test_config);
+}
+}
+;
+
+// Test the block CRC against the standard check value for the un-reflected CRC-32 with no final XOR
+TEST(test_crc, test_block_crc_check_value) {
+    const uint8_t check_string[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    CHECK_EQUAL(0x0376E6E7U, voyager_private_calculate_crc(check_string, sizeof(check_string)));
+}
+
+// Test that the block CRC is bit-identical to the byte-wise CRC for every length and alignment
+TEST(test_crc, test_block_crc_matches_byte_wise_crc) {
+    uint8_t buffer[80] = {0};
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t)((i * 37U) ^ 0xA5U);
+    }
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t length = 0; length <= sizeof(buffer) - offset; length++) {
+            voyager_bootloader_app_crc_t byte_wise_crc = 0xffffffff;
+            for (size_t i = 0; i < length; i++) {
+                voyager_private_calculate_crc_stream(buffer[offset + i], &byte_wise_crc);
+            }
+
+            CHECK_EQUAL(byte_wise_crc, voyager_private_calculate_crc(&buffer[offset], length));
+        }
+    }
+}
+
+// Test that a CRC accumulated over several blocks matches the CRC of the whole buffer
+TEST(test_crc, test_block_crc_can_be_continued) {
+    uint8_t buffer[64] = {0};
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t)(i * 11U);
+    }
+
+    voyager_bootloader_app_crc_t crc = 0xffffffff;
+    voyager_private_calculate_crc_block(buffer, 3, &crc);
+    voyager_private_calculate_crc_block(&buffer[3], 21, &crc);
+    voyager_private_calculate_crc_block(&buffer[24], sizeof(buffer) - 24, &crc);
+
+    CHECK_EQUAL(voyager_private_calculate_crc(buffer, sizeof(buffer)), crc);
+}
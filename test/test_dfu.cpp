@@ -45,8 +45,10 @@ void run_one_byte_ota(void) {
 
     CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
 
-    voyager_host_message_generator_generate_data_packet(packet_buffer, sizeof(packet_buffer), one_byte_app, sizeof(one_byte_app),
-                                                        true);
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    voyager_host_message_generator_generate_data_packet(&context, packet_buffer, sizeof(packet_buffer), one_byte_app,
+                                                        sizeof(one_byte_app));
 
     // OTA the one byte
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 3));
@@ -57,6 +59,38 @@ void run_one_byte_ota(void) {
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
 }
 
+// Runs a complete DFU of the given image, in packets of chunk_size bytes, from idle up to the final data packet
+void run_ota(const uint8_t *const image, size_t image_size, size_t chunk_size) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+
+    // Send START
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), image_size,
+                                                          voyager_host_calculate_crc(image, image_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    size_t written_size = 0U;
+    while (written_size < image_size) {
+        size_t packet_payload_size = chunk_size;
+        if (packet_payload_size > image_size - written_size) {
+            packet_payload_size = image_size - written_size;
+        }
+
+        size_t packet_size = voyager_host_message_generator_generate_data_packet(&context, packet_buffer, sizeof(packet_buffer),
+                                                                                 &image[written_size], packet_payload_size);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+        written_size += packet_payload_size;
+    }
+}
+
 // Test the packet creating function
 
 // Test that a start request without enter dfu request is rejected and sends an
@@ -76,11 +110,11 @@ TEST(test_dfu, start_request_without_enter_dfu_request) {
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
 
-    // Check the pending data flag is set
-    CHECK_EQUAL(true, voyager_private_get_data()->pending_data);
+    // Check that the packet is queued
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
 
     // Check that the packet size is set
-    CHECK_EQUAL(8U, voyager_private_get_data()->packet_size);
+    CHECK_EQUAL(8U, voyager_private_rx_queue_peek()->size);
 
     // Generate the comparison ack packet
     uint8_t ack_packet[VOYAGER_DFU_ACK_MESSAGE_SIZE] = {0};
@@ -100,8 +134,8 @@ TEST(test_dfu, start_request_without_enter_dfu_request) {
     // Check that the bootloader is still in idle
     CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
 
-    // Check that the pending data flag is cleared
-    CHECK_EQUAL(false, voyager_private_get_data()->pending_data);
+    // Check that the queue is drained
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
 
     // Check the mock expectations
     mock().checkExpectations();
@@ -131,11 +165,11 @@ TEST(test_dfu, start_request_with_enter_dfu_request) {
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
 
-    // Check the pending data flag is set
-    CHECK_EQUAL(true, voyager_private_get_data()->pending_data);
+    // Check that the packet is queued
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
 
     // Check that the packet size is set
-    CHECK_EQUAL(8U, voyager_private_get_data()->packet_size);
+    CHECK_EQUAL(8U, voyager_private_rx_queue_peek()->size);
 
     // Generate the comparison ack packet
     uint8_t ack_packet[VOYAGER_DFU_ACK_MESSAGE_SIZE] = {0};
@@ -160,8 +194,8 @@ TEST(test_dfu, start_request_with_enter_dfu_request) {
     CHECK_EQUAL(0xBEEFDEAD, mock_nvm_get_data()->app_crc);
     CHECK_EQUAL(0xDEBEAD, mock_nvm_get_data()->app_size);
 
-    // Check that the pending data flag is cleared
-    CHECK_EQUAL(false, voyager_private_get_data()->pending_data);
+    // Check that the queue is drained
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
 
     // Check the mock expectations
     mock().checkExpectations();
@@ -238,20 +272,23 @@ TEST(test_dfu, start_request_overrun) {
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
 
-    // Check the pending data flag is set
-    CHECK_EQUAL(true, voyager_private_get_data()->pending_data);
+    // Check that the packet is queued
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
 
     // Check that the packet size is set
-    CHECK_EQUAL(8U, voyager_private_get_data()->packet_size);
+    CHECK_EQUAL(8U, voyager_private_rx_queue_peek()->size);
 
-    // Process the packet again
-    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
+    // Fill the rest of the queue, then overrun it
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
+    }
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, voyager_private_rx_queue_count());
 
     // Check that the bootloader is still in idle
     CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
 
     // Check that the packet overrun flag is set
-    CHECK_EQUAL(true, voyager_private_get_data()->packet_overrun);
+    CHECK_EQUAL(true, voyager_private_rx_queue_overrun());
 
     // Generate a the ack packet to compare against
     uint8_t ack_packet[VOYAGER_DFU_ACK_MESSAGE_SIZE];
@@ -343,6 +380,8 @@ TEST(test_dfu, full_dfu_transfer_and_jump_to_application) {
     CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
 
     // for half of the size, write using 2 byte packets, then do the rest in 6
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
     size_t written_size = 0U;
     while (written_size != sizeof(fake_flash_data_1)) {
         size_t chunk_size = 2U;
@@ -356,7 +395,7 @@ TEST(test_dfu, full_dfu_transfer_and_jump_to_application) {
 
         // Create a data packet
         size_t bytes_written_to_packet_buffer = voyager_host_message_generator_generate_data_packet(
-            buffer, chunk_size + 2U, &fake_flash_data_1[written_size], chunk_size, (written_size == 0U));
+            &context, buffer, chunk_size + 2U, &fake_flash_data_1[written_size], chunk_size);
 
         // Process the packet
         CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written_to_packet_buffer));
@@ -472,9 +511,11 @@ TEST(test_dfu, out_of_sequence_data_packet) {
     // check that the current state is DFU receive
     CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
 
-    // generate the data packet with the reset sequence set to true
+    // generate the first data packet of the DFU
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
     size_t bytes_written = 0U;
-    bytes_written = voyager_host_message_generator_generate_data_packet(buffer, 8, &fake_flash_data_1[0], 2U, true);
+    bytes_written = voyager_host_message_generator_generate_data_packet(&context, buffer, 8, &fake_flash_data_1[0], 2U);
 
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written));
@@ -609,9 +650,11 @@ TEST(test_dfu, start_packet_while_in_dfu_receive) {
     // check that the current state is DFU receive
     CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
 
-    // generate the data packet with the reset sequence set to true
+    // generate the first data packet of the DFU
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
     size_t bytes_written = 0U;
-    bytes_written = voyager_host_message_generator_generate_data_packet(buffer, 8, &fake_flash_data_1[0], 2U, true);
+    bytes_written = voyager_host_message_generator_generate_data_packet(&context, buffer, 8, &fake_flash_data_1[0], 2U);
 
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written));
@@ -766,15 +809,19 @@ TEST(test_dfu, packet_overrun_dfu_receive) {
     // check that the current state is DFU receive
     CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
 
-    // generate the data packet with the reset sequence set to true
+    // generate the first data packet of the DFU
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
     size_t bytes_written = 0U;
-    bytes_written = voyager_host_message_generator_generate_data_packet(buffer, 8, &fake_flash_data_1[0], 2U, true);
+    bytes_written = voyager_host_message_generator_generate_data_packet(&context, buffer, 8, &fake_flash_data_1[0], 2U);
 
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written));
 
-    // Send the same packet again
-    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written));
+    // Send the same packet until the queue overruns
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, bytes_written));
+    }
 
     // Generate the comparison ack packet, which will contain the out of sequence
     // error
@@ -801,6 +848,119 @@ TEST(test_dfu, packet_overrun_dfu_receive) {
     CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
 }
 
+// Test that a burst of data packets that fits in the receive queue is processed without an overrun
+TEST(test_dfu, data_burst_fills_receive_queue) {
+    const size_t chunk_size = 16U;
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    const voyager_bootloader_app_size_t app_size = sizeof(fake_flash_data_1);
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), app_size,
+                                                          voyager_host_calculate_crc(fake_flash_data_1, app_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    // Deliver a full queue of packets back to back before the bootloader gets to run
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        size_t packet_size = voyager_host_message_generator_generate_data_packet(
+            &context, packet_buffer, sizeof(packet_buffer), &fake_flash_data_1[i * chunk_size], chunk_size);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+    }
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, voyager_private_rx_queue_count());
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+
+    // Each run drains one packet
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    }
+    mock().enable();
+
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_NONE, voyager_private_get_data()->dfu_error);
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH * chunk_size, voyager_private_get_data()->bytes_written);
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+}
+
+static bool late_packet_committed = false;
+
+// Plays the transport interrupt committing a START as soon as the bootloader, having prepared its overrun NACK, frees a
+// slot of the queue it is dropping
+static void commit_packet_during_overrun(void) {
+    const uint8_t *const ack = voyager_private_get_data()->ack_message_buffer;
+    if ((late_packet_committed == false) && (ack[1] == VOYAGER_DFU_ERROR_PACKET_OVERRUN) &&
+        (voyager_private_rx_queue_count() < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH)) {
+        late_packet_committed = true;
+        uint8_t packet[8] = {0};
+        voyager_host_message_generator_generate_start_request(packet, sizeof(packet), 16U, 1U);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+    }
+}
+
+// Overruns the receive queue, then runs the bootloader once while a packet is committed part way through handling it
+static void run_overrun_with_late_packet(const uint8_t *const packet, size_t packet_size) {
+    size_t ack_size = 0U;
+    for (size_t i = 0; i <= VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, packet_size));
+    }
+    CHECK_EQUAL(true, voyager_private_rx_queue_overrun());
+
+    late_packet_committed = false;
+    mock_dfu_set_memory_barrier_hook(commit_packet_during_overrun);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock_dfu_set_memory_barrier_hook(NULL);
+
+    CHECK_EQUAL(true, late_packet_committed);
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_PACKET_OVERRUN, voyager_host_check_ack_message(ack, ack_size));
+    // Only the packets queued before the NACK are dropped
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
+}
+
+// Test that a packet committed while an overrun is handled in idle is kept and answered on the next run
+TEST(test_dfu, packet_committed_during_idle_overrun_is_kept) {
+    uint8_t packet[8] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    voyager_host_message_generator_generate_start_request(packet, sizeof(packet), 16U, 1U);
+
+    run_overrun_with_late_packet(packet, sizeof(packet));
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_ENTER_DFU_NOT_REQUESTED, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+}
+
+// Test that a packet committed while an overrun is handled during DFU receive is not dropped with the overrun
+TEST(test_dfu, packet_committed_during_dfu_overrun_is_kept) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    mock().disable();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    const voyager_bootloader_app_crc_t app_crc = voyager_host_calculate_crc(fake_flash_data_1, sizeof(fake_flash_data_1));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), sizeof(fake_flash_data_1),
+                                                          app_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+        packet_buffer, sizeof(packet_buffer), fake_flash_data_1, 16U, 0U);
+    run_overrun_with_late_packet(packet_buffer, packet_size);
+    mock().enable();
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_PACKET_OVERRUN, voyager_private_get_data()->dfu_error);
+}
+
 // Test that a data packet without a start request is rejected and sends an
 // error
 TEST(test_dfu, data_but_not_started) {
@@ -811,16 +971,18 @@ TEST(test_dfu, data_but_not_started) {
 
     // Create a data packet
     uint8_t buffer[8] = {0};
-    voyager_host_message_generator_generate_data_packet(buffer, 8, NULL, 0, false);
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    voyager_host_message_generator_generate_data_packet(&context, buffer, 8, NULL, 0);
 
     // Process the packet
     CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(buffer, 8));
 
-    // Check the pending data flag is set
-    CHECK_EQUAL(true, voyager_private_get_data()->pending_data);
+    // Check that the packet is queued
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
 
     // Check that the packet size is set
-    CHECK_EQUAL(8U, voyager_private_get_data()->packet_size);
+    CHECK_EQUAL(8U, voyager_private_rx_queue_peek()->size);
 
     // Check that the bootloader is still in idle
     CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
@@ -865,11 +1027,11 @@ TEST(test_dfu, size_too_big) {
   CHECK_EQUAL(VOYAGER_ERROR_NONE,
               voyager_bootloader_process_receieved_packet(buffer, 8));
 
-  // Check the pending data flag is set
-  CHECK_EQUAL(true, voyager_private_get_data()->pending_data);
+  // Check that the packet is queued
+  CHECK_EQUAL(1U, voyager_private_rx_queue_count());
 
   // Check that the packet size is set
-  CHECK_EQUAL(8U, voyager_private_get_data()->packet_size);
+  CHECK_EQUAL(8U, voyager_private_rx_queue_peek()->size);
 
   // Check that the bootloader is still in idle
   CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
@@ -916,6 +1078,22 @@ TEST(test_dfu, start_request_unpack) {
     CHECK_EQUAL(0xADBEEF, message.message_payload.start_packet_data.app_size);
 }
 
+// Test the fill packet unpack function
+TEST(test_dfu, fill_packet_unpack) {
+    uint8_t buffer[6] = {0};
+    CHECK_EQUAL(6U, voyager_host_message_generator_generate_fill_packet_with_sequence(buffer, 6, 0xADBEEF, 0xA5, 7));
+
+    voyager_message_t message = voyager_private_unpack_message(buffer, 6);
+    CHECK_EQUAL(VOYAGER_MESSAGE_ID_FILL, message.header.message_id);
+    CHECK_EQUAL(7U, message.message_payload.fill_packet_data.sequence_number);
+    CHECK_EQUAL(0xADBEEF, message.message_payload.fill_packet_data.fill_length);
+    CHECK_EQUAL(0xA5U, message.message_payload.fill_packet_data.fill_value);
+
+    // A truncated fill packet is treated as an unknown message
+    message = voyager_private_unpack_message(buffer, 5);
+    CHECK_EQUAL(VOYAGER_MESSAGE_ID_UNKNOWN, message.header.message_id);
+}
+
 // Test the voyager host message generator process_ack function
 TEST(test_dfu, voyager_host_message_generator_crc_valid) {
     // Create a start request packet
@@ -971,6 +1149,69 @@ TEST(test_dfu, voyager_host_message_generator_sequence_error) {
     CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_OUT_OF_SEQUENCE, error);
 }
 
+// Test that each generator context numbers its own packets, wrapping after 255
+TEST(test_dfu, voyager_host_message_generator_independent_contexts) {
+    voyager_host_generator_context_t first;
+    voyager_host_generator_context_t second;
+    voyager_host_generator_context_init(&first);
+    voyager_host_generator_context_init(&second);
+
+    uint8_t buffer[4] = {0};
+    CHECK_EQUAL(4U, voyager_host_message_generator_generate_data_packet(&first, buffer, sizeof(buffer), fake_flash_data_1, 2U));
+    CHECK_EQUAL(0U, buffer[1]);
+    CHECK_EQUAL(4U, voyager_host_message_generator_generate_data_packet(&first, buffer, sizeof(buffer), fake_flash_data_1, 2U));
+    CHECK_EQUAL(1U, buffer[1]);
+    CHECK_EQUAL(4U, voyager_host_message_generator_generate_data_packet(&second, buffer, sizeof(buffer), fake_flash_data_1, 2U));
+    CHECK_EQUAL(0U, buffer[1]);
+
+    // A packet that does not fit does not use up a sequence number
+    CHECK_EQUAL(0U, voyager_host_message_generator_generate_data_packet(&first, buffer, sizeof(buffer), fake_flash_data_1, 3U));
+    CHECK_EQUAL(2U, first.next_sequence_number);
+    CHECK_EQUAL(0U, voyager_host_message_generator_generate_data_packet(NULL, buffer, sizeof(buffer), fake_flash_data_1, 2U));
+
+    first.next_sequence_number = 255U;
+    CHECK_EQUAL(4U, voyager_host_message_generator_generate_data_packet(&first, buffer, sizeof(buffer), fake_flash_data_1, 2U));
+    CHECK_EQUAL(255U, buffer[1]);
+    CHECK_EQUAL(0U, first.next_sequence_number);
+}
+
+// Test that a batch of packets matches generating them one at a time
+TEST(test_dfu, voyager_host_message_generator_data_packet_batch) {
+    static const size_t max_payload = 6U;
+    static const size_t image_size = 20U;
+    voyager_host_generator_context_t batch_context;
+    voyager_host_generator_context_t single_context;
+    voyager_host_generator_context_init(&batch_context);
+    voyager_host_generator_context_init(&single_context);
+
+    // Three full packets and a 2 byte one
+    uint8_t batch[image_size + (4U * 2U)] = {0};
+    CHECK_EQUAL(0U, voyager_host_message_generator_generate_data_packets(&batch_context, batch, sizeof(batch) - 1U,
+                                                                         fake_flash_data_1, image_size, max_payload, 4U));
+    CHECK_EQUAL(0U, batch_context.next_sequence_number);
+    CHECK_EQUAL(sizeof(batch), voyager_host_message_generator_generate_data_packets(&batch_context, batch, sizeof(batch),
+                                                                                    fake_flash_data_1, image_size, max_payload,
+                                                                                    10U));
+    CHECK_EQUAL(4U, batch_context.next_sequence_number);
+
+    uint8_t expected[max_payload + 2U] = {0};
+    size_t offset = 0U;
+    for (size_t image_offset = 0U; image_offset < image_size; image_offset += max_payload) {
+        const size_t payload_size = (image_size - image_offset < max_payload) ? image_size - image_offset : max_payload;
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet(
+            &single_context, expected, sizeof(expected), &fake_flash_data_1[image_offset], payload_size);
+        MEMCMP_EQUAL(expected, &batch[offset], packet_size);
+        offset += packet_size;
+    }
+    CHECK_EQUAL(sizeof(batch), offset);
+
+    // The next batch carries on from where the last one stopped
+    CHECK_EQUAL(max_payload + 2U, voyager_host_message_generator_generate_data_packets(&batch_context, batch, sizeof(batch),
+                                                                                       fake_flash_data_1, image_size,
+                                                                                       max_payload, 1U));
+    CHECK_EQUAL(4U, batch[1]);
+}
+
 // Test that jumping to the application does  happen if the feature flag to do so is true
 TEST(test_dfu, test_jump_to_app_feature_flag_enabled) {
     static const voyager_bootloader_config_t jump_to_app_feature_disabled{
@@ -1010,3 +1251,1225 @@ TEST(test_dfu, test_jump_to_app_feature_flag_disabled) {
 
     mock().enable();
 }
+
+// Test that the CRC accumulated during DFU lets the bootloader jump to the app without re-reading flash
+TEST(test_dfu, test_verify_crc_during_dfu_skips_flash_read) {
+    static const voyager_bootloader_config_t verify_during_dfu_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_crc_during_dfu = true,
+    };
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&verify_during_dfu_config));
+    run_ota(fake_flash_data_1, sizeof(fake_flash_data_1), 16U);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+
+    // The mock flash was never written, so only skipping the verification lets the jump happen
+    mock().enable();
+    mock()
+        .expectOneCall("voyager_bootloader_hal_jump_to_app")
+        .withParameter("app_start_address", mock_nvm_get_data()->app_start_address)
+        .andReturnValue(VOYAGER_ERROR_NONE);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().checkExpectations();
+
+    CHECK_EQUAL(VOYAGER_STATE_JUMP_TO_APP, voyager_bootloader_get_state());
+    CHECK_EQUAL(0U, mock_dfu_get_read_flash_call_count());
+}
+
+// Test that reading back each written chunk catches data that did not make it into flash
+TEST(test_dfu, test_verify_crc_during_dfu_with_readback) {
+    static const voyager_bootloader_config_t readback_config{
+        .jump_to_app_after_dfu_recv_complete = true,
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+    };
+    mock().disable();
+
+    // The mock flash already holds fake_flash_data_0, so reading it back matches the image
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&readback_config));
+    run_ota(fake_flash_data_0, sizeof(fake_flash_data_0), 32U);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+    // Each 32 byte payload is read back as two 16 byte chunks, and the final 1 byte payload as one
+    CHECK_EQUAL(9U, mock_dfu_get_read_flash_call_count());
+
+    // The mock flash does not hold fake_flash_data_1, so the read back CRC does not match
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&readback_config));
+    run_ota(fake_flash_data_1, sizeof(fake_flash_data_1), 32U);
+    CHECK_EQUAL(false, voyager_private_get_data()->app_verified_during_dfu);
+
+    mock().enable();
+}
+
+// Test that a START message requesting a sliding window is granted at most the receive queue depth
+TEST(test_dfu, windowed_start_request_grants_window) {
+    uint8_t start_packet[9] = {0};
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    CHECK_EQUAL(true, voyager_host_message_generator_generate_windowed_start_request(start_packet, sizeof(start_packet),
+                                                                                     FAKE_FLASH_SIZE, 0U, 200U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    size_t ack_size = 0U;
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, voyager_host_get_granted_window_size(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, voyager_private_get_data()->dfu_window_size);
+}
+
+// Test that a packet lost inside a sliding window is recovered by going back to it instead of aborting the DFU
+TEST(test_dfu, windowed_transfer_goes_back_after_lost_packet) {
+    const size_t chunk_size = 16U;
+    const uint8_t window_size = 4U;
+    uint8_t start_packet[9] = {0};
+    uint8_t packets[4][VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {{0}};
+    size_t packet_sizes[4] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_windowed_start_request(
+        start_packet, sizeof(start_packet), sizeof(fake_flash_data_1),
+        voyager_host_calculate_crc(fake_flash_data_1, sizeof(fake_flash_data_1)), window_size);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    const uint8_t *ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(window_size, voyager_host_get_granted_window_size(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    for (uint8_t sequence = 0; sequence < window_size; sequence++) {
+        packet_sizes[sequence] = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packets[sequence], sizeof(packets[sequence]), &fake_flash_data_1[sequence * chunk_size], chunk_size, sequence);
+    }
+
+    // Send a full window, but lose the second packet on the way
+    const size_t acks_before_window = mock_dfu_get_send_to_host_call_count();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[0], packet_sizes[0]));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[2], packet_sizes[2]));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[3], packet_sizes[3]));
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packets[0], packet_sizes[0]));
+
+    // The first packet after the gap is NACKed with the sequence number to go back to
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_OUT_OF_SEQUENCE,
+                voyager_host_compare_ack_message(ack, ack_size, packets[2], packet_sizes[2]));
+    CHECK_EQUAL(1U, voyager_host_get_resume_sequence_number(ack));
+
+    // The rest of the window is dropped without another NACK
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(acks_before_window + 2U, mock_dfu_get_send_to_host_call_count());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+    CHECK_EQUAL(chunk_size, voyager_private_get_data()->bytes_written);
+
+    // Go back and resend the rest of the window
+    for (uint8_t sequence = 1; sequence < window_size; sequence++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[sequence], packet_sizes[sequence]));
+    }
+    for (uint8_t sequence = 1; sequence < window_size; sequence++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    }
+    mock().enable();
+
+    ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packets[3], packet_sizes[3]));
+    CHECK_EQUAL(acks_before_window + 5U, mock_dfu_get_send_to_host_call_count());
+    CHECK_EQUAL(window_size * chunk_size, voyager_private_get_data()->bytes_written);
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_NONE, voyager_private_get_data()->dfu_error);
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+}
+
+// Test that batched mode sends one cumulative ACK per ACK interval and for the end of the image
+TEST(test_dfu, batched_ack_transfer) {
+    const size_t chunk_size = 16U;
+    const uint8_t ack_interval = 4U;
+    uint8_t start_packet[10] = {0};
+    uint8_t packet[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_batched_start_request(start_packet, sizeof(start_packet), sizeof(fake_flash_data_1),
+                                                                  0U, ack_interval, 200U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+    // The interval is clamped to the window
+    const uint8_t *ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(ack_interval, voyager_host_get_granted_window_size(ack, ack_size));
+    CHECK_EQUAL(ack_interval, voyager_host_get_granted_ack_interval(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    size_t acks_sent = mock_dfu_get_send_to_host_call_count();
+    uint32_t batch_crc = 0xffffffff;
+    uint8_t batch_count = 0U;
+    size_t written_size = 0U;
+    uint8_t sequence_number = 0U;
+    while (written_size < sizeof(fake_flash_data_1)) {
+        size_t payload_size = sizeof(fake_flash_data_1) - written_size;
+        if (payload_size > chunk_size) {
+            payload_size = chunk_size;
+        }
+        size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet, sizeof(packet), &fake_flash_data_1[written_size], payload_size, sequence_number);
+        batch_crc = voyager_host_accumulate_crc(batch_crc, &packet[1], packet_size - 1U);
+        batch_count++;
+        written_size += payload_size;
+
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+        if ((batch_count == ack_interval) || (written_size == sizeof(fake_flash_data_1))) {
+            CHECK_EQUAL(acks_sent + 1U, mock_dfu_get_send_to_host_call_count());
+            ack = mock_dfu_get_last_sent_message(&ack_size);
+            CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE,
+                        voyager_host_compare_batched_ack_message(ack, ack_size, batch_crc, sequence_number, batch_count));
+            acks_sent++;
+            batch_crc = 0xffffffff;
+            batch_count = 0U;
+        } else {
+            CHECK_EQUAL(acks_sent, mock_dfu_get_send_to_host_call_count());
+        }
+        sequence_number++;
+    }
+    mock().enable();
+
+    // 8 full packets and a 1 byte packet are covered by 3 ACKs
+    CHECK_EQUAL(9U, sequence_number);
+    CHECK_EQUAL(sizeof(fake_flash_data_1), voyager_private_get_data()->bytes_written);
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_NONE, voyager_private_get_data()->dfu_error);
+}
+
+// Test that the DFU data path reads the application addresses from NVM once per session instead of once per packet
+TEST(test_dfu, nvm_read_once_per_dfu_session) {
+    mock().disable();
+    mock_nvm_get_data()->read_call_count = 0U;
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    run_ota(fake_flash_data_1, sizeof(fake_flash_data_1), 16U);
+    mock().enable();
+
+    CHECK_EQUAL(sizeof(fake_flash_data_1), voyager_private_get_data()->bytes_written);
+    // Only the start and end address are read when the DFU starts. The 9 DATA packets used to read the start address
+    // each, on top of a duplicated end address read
+    CHECK_EQUAL(2U, mock_nvm_get_data()->read_call_count);
+}
+
+// Test that a failed NVM write does not leave a stale value in the RAM shadow
+TEST(test_dfu, nvm_cache_invalidated_by_failed_write) {
+    voyager_bootloader_nvm_data_t data;
+    mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+
+    data.app_size = 10U;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_SIZE, &data));
+    nvm_data->read_call_count = 0U;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_SIZE, &data));
+    CHECK_EQUAL(10U, data.app_size);
+    CHECK_EQUAL(0U, nvm_data->read_call_count);
+
+    nvm_data->write_error = VOYAGER_ERROR_GENERIC_ERROR;
+    data.app_size = 20U;
+    CHECK_EQUAL(VOYAGER_ERROR_GENERIC_ERROR, voyager_private_nvm_write(VOYAGER_NVM_KEY_APP_SIZE, &data));
+    nvm_data->write_error = VOYAGER_ERROR_NONE;
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_private_nvm_read(VOYAGER_NVM_KEY_APP_SIZE, &data));
+    CHECK_EQUAL(1U, nvm_data->read_call_count);
+}
+
+// Test that coalesced payloads reach flash as one write per aligned page, including the partial pages at either end
+TEST(test_dfu, coalesced_flash_writes_are_page_aligned) {
+    static const voyager_bootloader_config_t coalesce_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .coalesce_flash_writes = true,
+    };
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    // Payloads of 10 bytes straddle the page boundaries, so uncoalesced this would take 13 writes
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&coalesce_config));
+    run_ota(fake_flash_data_1, sizeof(fake_flash_data_1), 10U);
+    mock().enable();
+
+    const uintptr_t start_address = (uintptr_t)mock_dfu_get_flash();
+    const uintptr_t end_address = start_address + sizeof(fake_flash_data_1);
+    const size_t page_count = ((end_address + VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE - 1U) / VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE) -
+                              (start_address / VOYAGER_BOOTLOADER_FLASH_PAGE_SIZE);
+    CHECK_EQUAL(page_count, mock_dfu_get_write_flash_call_count());
+    MEMCMP_EQUAL(fake_flash_data_1, mock_dfu_get_flash(), sizeof(fake_flash_data_1));
+    // The CRC read back from flash only matches if every buffered byte was flushed, tail included
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+static const voyager_bootloader_addr_size_t TEST_SECTOR_SIZE = 32U;
+
+static voyager_error_E test_flash_sector_info(const voyager_bootloader_addr_size_t address,
+                                              voyager_bootloader_addr_size_t *const sector_start,
+                                              voyager_bootloader_addr_size_t *const sector_end) {
+    *sector_start = address - (address % TEST_SECTOR_SIZE);
+    *sector_end = *sector_start + TEST_SECTOR_SIZE;
+    return VOYAGER_ERROR_NONE;
+}
+
+// Test that lazy erase skips the up front erase and only erases the sectors the image is written into
+TEST(test_dfu, lazy_erase_only_erases_written_sectors) {
+    static const voyager_bootloader_config_t lazy_erase_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .flash_sector_info = test_flash_sector_info,
+    };
+    static const size_t image_size = 40U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    memset(mock_dfu_get_flash(), 0xA5, FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&lazy_erase_config));
+    run_ota(fake_flash_data_1, image_size, 8U);
+    mock().enable();
+
+    const uintptr_t start_address = (uintptr_t)mock_dfu_get_flash();
+    const size_t sector_count =
+        ((start_address + image_size + TEST_SECTOR_SIZE - 1U) / TEST_SECTOR_SIZE) - (start_address / TEST_SECTOR_SIZE);
+    CHECK_EQUAL(sector_count, mock_dfu_get_erase_flash_call_count());
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+
+    // The rest of the last sector the image touched is erased, flash past it was never erased
+    const size_t erased_size = (sector_count * TEST_SECTOR_SIZE) - (start_address % TEST_SECTOR_SIZE);
+    CHECK(erased_size < FAKE_FLASH_SIZE);
+    for (size_t i = image_size; i < erased_size; i++) {
+        CHECK_EQUAL(0xFFU, mock_dfu_get_flash()[i]);
+    }
+    CHECK_EQUAL(0xA5U, mock_dfu_get_flash()[erased_size]);
+}
+
+// Test that with a slow asynchronous flash the next packet is received while the previous one is programmed, and that
+// each packet is only ACKed once it is in flash
+TEST(test_dfu, async_flash_overlaps_reception_with_programming) {
+    static const voyager_bootloader_config_t async_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+    };
+    const size_t chunk_size = 16U;
+    const size_t packet_count = (sizeof(fake_flash_data_1) + chunk_size - 1U) / chunk_size;
+    uint8_t start_packet[9] = {0};
+    uint8_t packets[9][VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {{0}};
+    size_t packet_sizes[9] = {0};
+    size_t ack_size = 0U;
+    CHECK_EQUAL(packet_count, sizeof(packet_sizes) / sizeof(packet_sizes[0]));
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    mock_dfu_enable_async_flash(true);
+
+    for (size_t i = 0; i < packet_count; i++) {
+        const size_t offset = i * chunk_size;
+        const size_t remaining = sizeof(fake_flash_data_1) - offset;
+        const size_t payload_size = (remaining < chunk_size) ? remaining : chunk_size;
+        packet_sizes[i] = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packets[i], sizeof(packets[i]), &fake_flash_data_1[offset], payload_size, (uint8_t)i);
+    }
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&async_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_windowed_start_request(
+        start_packet, sizeof(start_packet), sizeof(fake_flash_data_1),
+        voyager_host_calculate_crc(fake_flash_data_1, sizeof(fake_flash_data_1)), 2U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    // The partition erase runs in the background, the first packet waits for it in the queue
+    CHECK_EQUAL(true, mock_dfu_flash_op_pending());
+    const size_t acks_after_start = mock_dfu_get_send_to_host_call_count();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[0], packet_sizes[0]));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+
+    for (size_t i = 0; i < packet_count; i++) {
+        // Start programming packet i
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        CHECK_EQUAL(true, mock_dfu_flash_op_pending());
+
+        // Packet i + 1 arrives while packet i is being programmed
+        if (i + 1U < packet_count) {
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packets[i + 1U], packet_sizes[i + 1U]));
+            CHECK_EQUAL(2U, voyager_private_rx_queue_count());
+        }
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        CHECK_EQUAL(acks_after_start + i, mock_dfu_get_send_to_host_call_count());
+
+        // Packet i is ACKed once the write completes
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        CHECK_EQUAL(acks_after_start + i + 1U, mock_dfu_get_send_to_host_call_count());
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packets[i], packet_sizes[i]));
+    }
+    mock().enable();
+
+    CHECK_EQUAL(false, mock_dfu_flash_op_pending());
+    CHECK_EQUAL(sizeof(fake_flash_data_1), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(fake_flash_data_1, mock_dfu_get_flash(), sizeof(fake_flash_data_1));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that page coalescing and lazy erase resume correctly when every flash operation completes asynchronously
+TEST(test_dfu, async_flash_with_coalesced_writes_and_lazy_erase) {
+    static const voyager_bootloader_config_t async_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .coalesce_flash_writes = true,
+        .flash_sector_info = test_flash_sector_info,
+    };
+    const size_t chunk_size = 10U;
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    mock_dfu_enable_async_flash(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&async_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    const uint32_t app_crc = voyager_host_calculate_crc(fake_flash_data_1, sizeof(fake_flash_data_1));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), sizeof(fake_flash_data_1),
+                                                          app_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(false, mock_dfu_flash_op_pending());
+
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    size_t written_size = 0U;
+    while (written_size < sizeof(fake_flash_data_1)) {
+        const size_t acks_before_packet = mock_dfu_get_send_to_host_call_count();
+        size_t payload_size = sizeof(fake_flash_data_1) - written_size;
+        if (payload_size > chunk_size) {
+            payload_size = chunk_size;
+        }
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet(
+            &context, packet_buffer, sizeof(packet_buffer), &fake_flash_data_1[written_size], payload_size);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+
+        // Complete each erase and write as the bootloader starts it
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        while (mock_dfu_flash_op_pending()) {
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        }
+        CHECK_EQUAL(acks_before_packet + 1U, mock_dfu_get_send_to_host_call_count());
+        written_size += payload_size;
+    }
+    mock().enable();
+
+    CHECK_EQUAL(sizeof(fake_flash_data_1), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(fake_flash_data_1, mock_dfu_get_flash(), sizeof(fake_flash_data_1));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that a failed asynchronous flash operation is reported when the bootloader next touches flash
+TEST(test_dfu, async_flash_failure_is_reported) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    mock().disable();
+    mock_dfu_enable_async_flash(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    const uint32_t app_crc = voyager_host_calculate_crc(fake_flash_data_1, sizeof(fake_flash_data_1));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), sizeof(fake_flash_data_1),
+                                                          app_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_GENERIC_ERROR));
+
+    // Completing an operation that is not in flight is rejected
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_hal_op_complete(VOYAGER_ERROR_NONE));
+
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    const size_t packet_size = voyager_host_message_generator_generate_data_packet(&context, packet_buffer, sizeof(packet_buffer),
+                                                                                   fake_flash_data_1, 16U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+    CHECK_EQUAL(VOYAGER_ERROR_GENERIC_ERROR, voyager_bootloader_run());
+    CHECK_EQUAL(0U, mock_dfu_get_write_flash_call_count());
+    mock().enable();
+}
+
+// Test that payload runs of the erased value are not written, while the image still ends up in flash intact
+TEST(test_dfu, skip_erased_writes_skips_padding) {
+    static const voyager_bootloader_config_t skip_erased_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .skip_erased_writes = true,
+    };
+    uint8_t padded_image[FAKE_FLASH_SIZE];
+    memcpy(padded_image, fake_flash_data_1, sizeof(padded_image));
+    memset(&padded_image[32], VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE, 80U);
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    memset(mock_dfu_get_flash(), 0xA5, FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&skip_erased_config));
+    run_ota(padded_image, sizeof(padded_image), 16U);
+    mock().enable();
+
+    // Of the 9 packets, the 5 that only carry padding are skipped
+    CHECK_EQUAL(4U, mock_dfu_get_write_flash_call_count());
+    CHECK_EQUAL(sizeof(padded_image), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(padded_image, mock_dfu_get_flash(), sizeof(padded_image));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test how a write is split into runs that are written and runs of the erased value that are skipped
+TEST(test_dfu, next_write_run_splits_on_long_erased_runs) {
+    const uint8_t erased = VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE;
+    const uint8_t written = (uint8_t)~VOYAGER_BOOTLOADER_FLASH_ERASED_VALUE;
+    const uint8_t data[10] = {written, erased, written, erased, erased, erased, erased, written, erased, erased};
+    bool run_erased = false;
+
+    // A short erased run is written along with the data around it, a long one ends the run
+    CHECK_EQUAL(3U, voyager_private_next_write_run(data, sizeof(data), 4U, &run_erased));
+    CHECK_EQUAL(false, run_erased);
+    CHECK_EQUAL(4U, voyager_private_next_write_run(&data[3], sizeof(data) - 3U, 4U, &run_erased));
+    CHECK_EQUAL(true, run_erased);
+
+    // A short erased tail is written too, unless it is all that is left
+    CHECK_EQUAL(3U, voyager_private_next_write_run(&data[7], sizeof(data) - 7U, 4U, &run_erased));
+    CHECK_EQUAL(false, run_erased);
+    CHECK_EQUAL(2U, voyager_private_next_write_run(&data[8], sizeof(data) - 8U, 4U, &run_erased));
+    CHECK_EQUAL(true, run_erased);
+
+    // With a minimum as long as the data, only data made up entirely of the erased value is skipped
+    CHECK_EQUAL(10U, voyager_private_next_write_run(data, sizeof(data), sizeof(data), &run_erased));
+    CHECK_EQUAL(false, run_erased);
+}
+
+// Test that padding collapsed into a FILL packet by the host generator is written to flash without being transferred
+TEST(test_dfu, fill_packets_collapse_padding) {
+    static const voyager_bootloader_config_t fill_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+    };
+    uint8_t padded_image[FAKE_FLASH_SIZE];
+    for (size_t i = 0; i < sizeof(padded_image); i++) {
+        padded_image[i] = (uint8_t)((i * 7U) + 3U);
+    }
+    memset(&padded_image[40], 0xFF, 60U);
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    memset(mock_dfu_get_flash(), 0xA5, FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&fill_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    const uint32_t app_crc = voyager_host_calculate_crc(padded_image, sizeof(padded_image));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), sizeof(padded_image), app_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    size_t sent_size = 0U;
+    uint8_t sequence_number = 0U;
+    while (sent_size < sizeof(padded_image)) {
+        size_t consumed = 0U;
+        const size_t packet_size = voyager_host_message_generator_generate_image_packet(
+            packet_buffer, sizeof(packet_buffer), &padded_image[sent_size], sizeof(padded_image) - sent_size, 16U,
+            sequence_number, &consumed);
+        CHECK(consumed > 0U);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packet_buffer, packet_size));
+        sent_size += consumed;
+        sequence_number++;
+    }
+    mock().enable();
+
+    // 40 bytes of data, a 60 byte fill written in 32 byte chunks, then the last 29 bytes of data
+    CHECK_EQUAL(3U, sequence_number);
+    CHECK_EQUAL(4U, mock_dfu_get_write_flash_call_count());
+    CHECK_EQUAL(sizeof(padded_image), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(padded_image, mock_dfu_get_flash(), sizeof(padded_image));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that a FILL packet running past the end of the application aborts the DFU
+TEST(test_dfu, fill_past_end_of_application_is_rejected) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), 16U, 0U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    const size_t packet_size =
+        voyager_host_message_generator_generate_fill_packet_with_sequence(packet_buffer, sizeof(packet_buffer), 17U, 0xFFU, 0U);
+    CHECK_EQUAL(6U, packet_size);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_SIZE_TOO_LARGE, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(0U, voyager_private_get_data()->bytes_written);
+    CHECK_EQUAL(0U, mock_dfu_get_write_flash_call_count());
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_SIZE_TOO_LARGE, voyager_private_get_data()->dfu_error);
+}
+
+// Builds an image with the repeated instruction patterns, padding and unique data a compressor meets in firmware
+static void make_compressible_image(uint8_t image[FAKE_FLASH_SIZE]) {
+    for (size_t i = 0; i < FAKE_FLASH_SIZE; i++) {
+        image[i] = (uint8_t)((i * 7U) + 3U);
+    }
+    for (size_t i = 0; i < 40U; i++) {
+        image[i] = (uint8_t)(0x40U + (i % 6U));
+    }
+    memset(&image[60], 0xFF, 45U);
+}
+
+// Runs a compressed DFU of the image, completing every flash operation the HAL starts in the background, and
+// returns the number of DATA packets sent
+static size_t run_compressed_ota(const uint8_t *const image, size_t image_size) {
+    uint8_t stream[FAKE_FLASH_SIZE + (FAKE_FLASH_SIZE / 8U) + 1U] = {0};
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    const size_t stream_size =
+        voyager_host_lz_compress(image, image_size, stream, sizeof(stream), VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+    CHECK(stream_size > 0U);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    CHECK_EQUAL(true, voyager_host_message_generator_generate_compressed_start_request(
+                          packet_buffer, sizeof(packet_buffer), image_size, voyager_host_calculate_crc(image, image_size), 1U,
+                          1U, VOYAGER_BOOTLOADER_LZ_WINDOW_BITS));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 12U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    size_t sent_size = 0U;
+    size_t packet_count = 0U;
+    while (sent_size < stream_size) {
+        // The stream is split without regard for item boundaries
+        size_t payload_size = sizeof(packet_buffer) - 2U;
+        if (payload_size > stream_size - sent_size) {
+            payload_size = stream_size - sent_size;
+        }
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet_buffer, sizeof(packet_buffer), &stream[sent_size], payload_size, (uint8_t)packet_count);
+        const size_t acks_before = mock_dfu_get_send_to_host_call_count();
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        while (mock_dfu_flash_op_pending()) {
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        }
+
+        CHECK_EQUAL(acks_before + 1U, mock_dfu_get_send_to_host_call_count());
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packet_buffer, packet_size));
+        sent_size += payload_size;
+        packet_count++;
+    }
+
+    return packet_count;
+}
+
+// Test that a compressed image is decompressed into flash, through a window that wraps several times
+TEST(test_dfu, compressed_transfer_round_trip) {
+    static const voyager_bootloader_config_t compressed_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+    };
+    uint8_t image[FAKE_FLASH_SIZE];
+    make_compressible_image(image);
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    memset(mock_dfu_get_flash(), 0xA5, FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&compressed_config));
+    // Uncompressed, the image takes 3 DATA packets
+    CHECK_EQUAL(2U, run_compressed_ota(image, sizeof(image)));
+    mock().enable();
+
+    CHECK_EQUAL(sizeof(image), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that decompression resumes correctly when window flushes go through the page buffer to an asynchronous HAL
+TEST(test_dfu, compressed_transfer_with_async_coalesced_flash) {
+    static const voyager_bootloader_config_t compressed_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .coalesce_flash_writes = true,
+    };
+    uint8_t image[FAKE_FLASH_SIZE];
+    make_compressible_image(image);
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    mock_dfu_enable_async_flash(true);
+    memset(mock_dfu_get_flash(), 0xA5, FAKE_FLASH_SIZE);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&compressed_config));
+    run_compressed_ota(image, sizeof(image));
+    mock().enable();
+
+    CHECK_EQUAL(sizeof(image), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that a compressed START is rejected if the host compressed with a larger window than the target decompresses with
+TEST(test_dfu, compressed_start_with_larger_window_is_rejected) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_compressed_start_request(packet_buffer, sizeof(packet_buffer), 16U, 0U, 1U, 1U,
+                                                                     VOYAGER_BOOTLOADER_LZ_WINDOW_BITS + 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 12U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_UNSUPPORTED_FEATURE, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
+}
+
+// Test that a match reaching back before the start of the application aborts the DFU
+TEST(test_dfu, corrupt_compressed_payload_is_rejected) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_compressed_start_request(packet_buffer, sizeof(packet_buffer), 16U, 0U, 1U, 1U,
+                                                                     VOYAGER_BOOTLOADER_LZ_WINDOW_BITS);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 12U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    // One literal, then a match 2 bytes back
+    const uint8_t stream[] = {0x01U, 0x5AU, 0x00U, 0x10U};
+    const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+        packet_buffer, sizeof(packet_buffer), stream, sizeof(stream), 0U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_INVALID_COMPRESSED_DATA, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_INVALID_COMPRESSED_DATA, voyager_private_get_data()->dfu_error);
+    CHECK_EQUAL(0U, voyager_private_get_data()->bytes_written);
+}
+
+// Builds the next version of fake_flash_data_0: a changed run, an inserted run and a dropped run
+static void make_delta_image(uint8_t image[FAKE_FLASH_SIZE]) {
+    uint8_t base[FAKE_FLASH_SIZE];
+    memcpy(base, fake_flash_data_0, sizeof(base));
+    for (size_t i = 6; i < FAKE_FLASH_SIZE; i++) {
+        base[i] = (uint8_t)(i * 13U);
+    }
+    memcpy(image, base, 40U);
+    memset(&image[40], 0x77, 10U);
+    memcpy(&image[50], &base[50], 30U);
+    memcpy(&image[80], "inserted", 8U);
+    memcpy(&image[88], &base[84], FAKE_FLASH_SIZE - 88U);
+}
+
+// Installs the base make_delta_image patches against as the current application
+static void install_delta_base(void) {
+    uint8_t *const flash = mock_dfu_get_flash();
+    for (size_t i = 6; i < FAKE_FLASH_SIZE; i++) {
+        flash[i] = (uint8_t)(i * 13U);
+    }
+    mock_nvm_get_data()->app_crc = voyager_host_calculate_crc(flash, FAKE_FLASH_SIZE);
+    // Keep the partition clear of the staging area
+    mock_nvm_get_data()->app_end_address = mock_nvm_get_data()->app_start_address + FAKE_FLASH_SIZE;
+}
+
+// Runs a delta DFU from the current application to the image, completing every flash operation the HAL starts in the
+// background. The START claims app_crc for the image, and the error in the ACK of the last DATA packet is returned
+static voyager_host_dfu_error_E run_delta_ota(const uint8_t *const image, size_t image_size, uint32_t app_crc) {
+    uint8_t patch[FAKE_FLASH_SIZE + 8U] = {0};
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    const size_t patch_size =
+        voyager_host_generate_patch(mock_dfu_get_flash(), FAKE_FLASH_SIZE, image, image_size, patch, sizeof(patch));
+    CHECK(patch_size > 0U);
+    // Most of the image is copied from the current application
+    CHECK(patch_size < (image_size / 2U));
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    CHECK_EQUAL(true, voyager_host_message_generator_generate_delta_start_request(
+                          packet_buffer, sizeof(packet_buffer), image_size, app_crc, 1U, 1U,
+                          voyager_host_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 16U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
+    size_t sent_size = 0U;
+    uint8_t sequence_number = 0U;
+    while (sent_size < patch_size) {
+        // Split the patch into small payloads, so that op headers straddle packets
+        size_t payload_size = 5U;
+        if (payload_size > patch_size - sent_size) {
+            payload_size = patch_size - sent_size;
+        }
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet_buffer, sizeof(packet_buffer), &patch[sent_size], payload_size, sequence_number++);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        while (mock_dfu_flash_op_pending()) {
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        }
+
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        ret = voyager_host_check_ack_message(ack, ack_size);
+        sent_size += payload_size;
+        if (sent_size < patch_size) {
+            // The current application is only replaced once the whole patch has been applied and checked
+            CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packet_buffer, packet_size));
+            CHECK_EQUAL(mock_nvm_get_data()->app_crc, voyager_host_calculate_crc(mock_dfu_get_flash(), FAKE_FLASH_SIZE));
+        }
+    }
+
+    return ret;
+}
+
+// Test that a patch is reconstructed in the staging area, then installed over the application it was generated against
+TEST(test_dfu, delta_transfer_round_trip) {
+    const voyager_bootloader_config_t delta_config{
+        .verify_crc_during_dfu = true,
+        .delta_staging_start_address = (uintptr_t)mock_dfu_get_staging_flash(),
+        .delta_staging_end_address = (uintptr_t)mock_dfu_get_staging_flash() + FAKE_FLASH_SIZE,
+    };
+    uint8_t image[FAKE_FLASH_SIZE];
+    make_delta_image(image);
+    install_delta_base();
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&delta_config));
+    const uint32_t image_crc = voyager_host_calculate_crc(image, sizeof(image));
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, run_delta_ota(image, sizeof(image), image_crc));
+    mock().enable();
+
+    CHECK_EQUAL(sizeof(image), voyager_private_get_data()->bytes_written);
+    MEMCMP_EQUAL(image, mock_dfu_get_staging_flash(), sizeof(image));
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+    CHECK_EQUAL(sizeof(image), mock_nvm_get_data()->app_size);
+    CHECK_EQUAL(image_crc, mock_nvm_get_data()->app_crc);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that a delta update resumes correctly through the page buffer, an asynchronous HAL and lazy erase
+TEST(test_dfu, delta_transfer_with_async_coalesced_flash) {
+    const voyager_bootloader_config_t delta_config{
+        .verify_crc_during_dfu = true,
+        .readback_flash_during_dfu = true,
+        .coalesce_flash_writes = true,
+        .flash_sector_info = test_flash_sector_info,
+        .delta_staging_start_address = (uintptr_t)mock_dfu_get_staging_flash(),
+        .delta_staging_end_address = (uintptr_t)mock_dfu_get_staging_flash() + FAKE_FLASH_SIZE,
+    };
+    uint8_t image[FAKE_FLASH_SIZE];
+    make_delta_image(image);
+    install_delta_base();
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    mock_dfu_enable_async_flash(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&delta_config));
+    const uint32_t image_crc = voyager_host_calculate_crc(image, sizeof(image));
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, run_delta_ota(image, sizeof(image), image_crc));
+    mock().enable();
+
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+    CHECK_EQUAL(voyager_host_calculate_crc(image, sizeof(image)), mock_nvm_get_data()->app_crc);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that a patch that does not reconstruct the announced image leaves the current application in place
+TEST(test_dfu, delta_patch_with_wrong_result_is_not_installed) {
+    const voyager_bootloader_config_t delta_config{
+        .delta_staging_start_address = (uintptr_t)mock_dfu_get_staging_flash(),
+        .delta_staging_end_address = (uintptr_t)mock_dfu_get_staging_flash() + FAKE_FLASH_SIZE,
+    };
+    uint8_t image[FAKE_FLASH_SIZE];
+    uint8_t base[FAKE_FLASH_SIZE];
+    make_delta_image(image);
+    install_delta_base();
+    memcpy(base, mock_dfu_get_flash(), sizeof(base));
+    const voyager_bootloader_app_crc_t base_crc = mock_nvm_get_data()->app_crc;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&delta_config));
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_INVALID_PATCH,
+                run_delta_ota(image, sizeof(image), voyager_host_calculate_crc(image, sizeof(image)) ^ 1U));
+    mock().enable();
+
+    MEMCMP_EQUAL(base, mock_dfu_get_flash(), sizeof(base));
+    CHECK_EQUAL(base_crc, mock_nvm_get_data()->app_crc);
+    CHECK_EQUAL(VOYAGER_DFU_ERROR_INVALID_PATCH, voyager_private_get_data()->dfu_error);
+}
+
+// Test that a delta START is rejected if the target is not running the application the patch was generated against
+TEST(test_dfu, delta_start_with_wrong_base_is_rejected) {
+    const voyager_bootloader_config_t delta_config{
+        .delta_staging_start_address = (uintptr_t)mock_dfu_get_staging_flash(),
+        .delta_staging_end_address = (uintptr_t)mock_dfu_get_staging_flash() + FAKE_FLASH_SIZE,
+    };
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    install_delta_base();
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&delta_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_delta_start_request(packet_buffer, sizeof(packet_buffer), 16U, 0U, 1U, 1U,
+                                                                mock_nvm_get_data()->app_crc + 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 16U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_BASE_IMAGE_MISMATCH, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
+    CHECK_EQUAL(0U, mock_dfu_get_erase_flash_call_count());
+}
+
+// Sends image[from, to) in DATA packets of 20 bytes, checking every ACK
+static void send_image_range(const uint8_t *const image, size_t from, size_t to, uint8_t *const sequence_number) {
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    for (size_t offset = from; offset < to; offset += 20U) {
+        const size_t payload_size = ((to - offset) < 20U) ? (to - offset) : 20U;
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet_buffer, sizeof(packet_buffer), &image[offset], payload_size, (*sequence_number)++);
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packet_buffer, packet_size));
+    }
+}
+
+// Sends a QUERY for the image and returns the offset the target can resume it from
+static uint32_t query_checkpoint(const uint8_t *const image, size_t image_size) {
+    uint8_t packet_buffer[8] = {0};
+    size_t ack_size = 0U;
+    CHECK_EQUAL(true, voyager_host_message_generator_generate_query_request(packet_buffer, sizeof(packet_buffer), image_size,
+                                                                             voyager_host_calculate_crc(image, image_size)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, sizeof(packet_buffer)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_check_ack_message(ack, ack_size));
+    return voyager_host_get_checkpoint_offset(ack);
+}
+
+// Test that a DFU interrupted by a power cycle resumes from its last checkpoint and still produces a verified image
+TEST(test_dfu, resume_from_checkpoint_after_power_cycle) {
+    static const voyager_bootloader_config_t checkpoint_config{
+        .verify_crc_during_dfu = true,
+        .dfu_checkpoint_interval = 32U,
+    };
+    const uint8_t *const image = fake_flash_data_1;
+    const uint32_t image_crc = voyager_host_calculate_crc(image, FAKE_FLASH_SIZE);
+    uint8_t packet_buffer[12] = {0};
+    size_t ack_size = 0U;
+    uint8_t sequence_number = 0U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE, image_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    send_image_range(image, 0U, 80U, &sequence_number);
+
+    // Power is lost with 80 bytes in flash, the last checkpoint was taken at 64
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    memset(&mock_dfu_get_flash()[64], 0x00, 16U);
+    CHECK_EQUAL(64U, query_checkpoint(image, FAKE_FLASH_SIZE));
+    CHECK_EQUAL(0U, query_checkpoint(fake_flash_data_0, FAKE_FLASH_SIZE));
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_resume_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE,
+                                                                 image_crc, 1U, 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, sizeof(packet_buffer)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_STATE_DFU_RECEIVE, voyager_bootloader_get_state());
+
+    // The flash after the checkpoint is erased again, the flash before it is kept
+    const uint8_t erased[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    MEMCMP_EQUAL(erased, &mock_dfu_get_flash()[64], sizeof(erased));
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), 64U);
+
+    sequence_number = 0U;
+    send_image_range(image, 64U, FAKE_FLASH_SIZE, &sequence_number);
+    mock().enable();
+
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+    CHECK_EQUAL(FAKE_FLASH_SIZE, voyager_private_get_data()->bytes_written);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+    // Nothing is left to resume once the DFU completes
+    CHECK(mock_nvm_get_data()->dfu_checkpoint_session != voyager_private_checkpoint_session(FAKE_FLASH_SIZE, image_crc));
+}
+
+// Test that a compressed DFU of another image drops the checkpoint of an interrupted plain DFU
+TEST(test_dfu, compressed_dfu_clears_checkpoint) {
+    static const voyager_bootloader_config_t checkpoint_config{
+        .verify_crc_during_dfu = true,
+        .dfu_checkpoint_interval = 32U,
+    };
+    const uint8_t *const image = fake_flash_data_1;
+    const uint32_t image_crc = voyager_host_calculate_crc(image, FAKE_FLASH_SIZE);
+    uint8_t compressed_image[FAKE_FLASH_SIZE] = {0};
+    uint8_t packet_buffer[12] = {0};
+    size_t ack_size = 0U;
+    uint8_t sequence_number = 0U;
+    make_compressible_image(compressed_image);
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE, image_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    send_image_range(image, 0U, 80U, &sequence_number);
+
+    // The plain DFU is abandoned with a checkpoint at 64, and another image is sent compressed instead
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(64U, query_checkpoint(image, FAKE_FLASH_SIZE));
+    run_compressed_ota(compressed_image, FAKE_FLASH_SIZE);
+    MEMCMP_EQUAL(compressed_image, mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+
+    // The first image can only be sent again from the start
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(0U, query_checkpoint(image, FAKE_FLASH_SIZE));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_resume_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE,
+                                                                 image_crc, 1U, 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, sizeof(packet_buffer)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NO_CHECKPOINT, voyager_host_check_ack_message(ack, ack_size));
+    MEMCMP_EQUAL(compressed_image, mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+}
+
+// Splits the application partition into sectors of TEST_SECTOR_SIZE bytes counted from its start
+static voyager_error_E test_app_sector_info(const voyager_bootloader_addr_size_t address,
+                                            voyager_bootloader_addr_size_t *const sector_start,
+                                            voyager_bootloader_addr_size_t *const sector_end) {
+    const voyager_bootloader_addr_size_t offset = address - (uintptr_t)mock_dfu_get_flash();
+    *sector_start = address - (offset % TEST_SECTOR_SIZE);
+    *sector_end = *sector_start + TEST_SECTOR_SIZE;
+    return VOYAGER_ERROR_NONE;
+}
+
+// Test that with lazy erase, a checkpoint part way into a sector is not resumed from, since resuming erases that sector
+TEST(test_dfu, checkpoint_inside_sector_is_not_resumed) {
+    static const voyager_bootloader_config_t checkpoint_config{
+        .verify_crc_during_dfu = true,
+        .flash_sector_info = test_app_sector_info,
+        .dfu_checkpoint_interval = 24U,
+    };
+    const uint8_t *const image = fake_flash_data_1;
+    const uint32_t image_crc = voyager_host_calculate_crc(image, FAKE_FLASH_SIZE);
+    uint8_t packet_buffer[12] = {0};
+    size_t ack_size = 0U;
+    uint8_t sequence_number = 0U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE, image_crc);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, 8U));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    send_image_range(image, 0U, 80U, &sequence_number);
+
+    // The last checkpoint was taken at 72, 8 bytes into the third sector
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(72U, mock_nvm_get_data()->dfu_checkpoint_offset);
+    CHECK_EQUAL(0U, query_checkpoint(image, FAKE_FLASH_SIZE));
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_resume_start_request(packet_buffer, sizeof(packet_buffer), FAKE_FLASH_SIZE,
+                                                                 image_crc, 1U, 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, sizeof(packet_buffer)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NO_CHECKPOINT, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), 64U);
+}
+
+// Test that a resuming START is rejected if no checkpoint of the application is stored
+TEST(test_dfu, resume_without_checkpoint_is_rejected) {
+    static const voyager_bootloader_config_t checkpoint_config{
+        .dfu_checkpoint_interval = 32U,
+    };
+    uint8_t packet_buffer[12] = {0};
+    size_t ack_size = 0U;
+    mock_nvm_get_data()->dfu_checkpoint_session = 0U;
+    mock().disable();
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&checkpoint_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_resume_start_request(packet_buffer, sizeof(packet_buffer), 16U, 0x12345678U, 1U,
+                                                                 1U);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, sizeof(packet_buffer)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    mock().enable();
+
+    const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NO_CHECKPOINT, voyager_host_check_ack_message(ack, ack_size));
+    CHECK_EQUAL(VOYAGER_STATE_IDLE, voyager_bootloader_get_state());
+    CHECK_EQUAL(0U, mock_dfu_get_erase_flash_call_count());
+}
+
+// Test that background erase erases the sectors of the image between packets, so no packet waits for an erase
+TEST(test_dfu, background_erase_runs_between_packets) {
+    static const voyager_bootloader_config_t background_erase_config{
+        .verify_crc_during_dfu = true,
+        .flash_sector_info = test_flash_sector_info,
+        .background_erase = true,
+    };
+    uint8_t start_packet[8] = {0};
+    uint8_t sequence_number = 0U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&background_erase_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(start_packet, sizeof(start_packet), FAKE_FLASH_SIZE,
+                                                          voyager_host_calculate_crc(fake_flash_data_1, FAKE_FLASH_SIZE));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    // The START is ACKed before anything is erased
+    CHECK_EQUAL(1U, mock_dfu_get_send_to_host_call_count());
+    CHECK_EQUAL(0U, mock_dfu_get_erase_flash_call_count());
+
+    // One sector is erased per call while no packet is waiting, stopping at the end of the image
+    const uintptr_t start_address = (uintptr_t)mock_dfu_get_flash();
+    const size_t sector_count =
+        ((start_address + FAKE_FLASH_SIZE + TEST_SECTOR_SIZE - 1U) / TEST_SECTOR_SIZE) - (start_address / TEST_SECTOR_SIZE);
+    for (size_t i = 0; i < (sector_count + 4U); i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        CHECK(mock_dfu_get_erase_flash_call_count() <= (i + 1U));
+    }
+    CHECK_EQUAL(sector_count, mock_dfu_get_erase_flash_call_count());
+
+    send_image_range(fake_flash_data_1, 0U, FAKE_FLASH_SIZE, &sequence_number);
+    mock().enable();
+
+    CHECK_EQUAL(sector_count, mock_dfu_get_erase_flash_call_count());
+    MEMCMP_EQUAL(fake_flash_data_1, mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
+
+// Test that with an asynchronous flash a packet arriving during a background erase waits in the receive queue
+TEST(test_dfu, background_erase_buffers_packets_until_erased) {
+    static const voyager_bootloader_config_t background_erase_config{
+        .verify_crc_during_dfu = true,
+        .flash_sector_info = test_flash_sector_info,
+        .background_erase = true,
+    };
+    uint8_t start_packet[8] = {0};
+    uint8_t packet_buffer[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE] = {0};
+    size_t ack_size = 0U;
+    mock().disable();
+    mock_dfu_enable_flash_emulation(true);
+    mock_dfu_enable_async_flash(true);
+
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&background_erase_config));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+    voyager_host_message_generator_generate_start_request(start_packet, sizeof(start_packet), FAKE_FLASH_SIZE,
+                                                          voyager_host_calculate_crc(fake_flash_data_1, FAKE_FLASH_SIZE));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(start_packet, sizeof(start_packet)));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+    CHECK_EQUAL(true, mock_dfu_flash_op_pending());
+
+    size_t sent_size = 0U;
+    uint8_t sequence_number = 0U;
+    while (sent_size < FAKE_FLASH_SIZE) {
+        const size_t payload_size = ((FAKE_FLASH_SIZE - sent_size) < 20U) ? (FAKE_FLASH_SIZE - sent_size) : 20U;
+        const size_t packet_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet_buffer, sizeof(packet_buffer), &fake_flash_data_1[sent_size], payload_size, sequence_number++);
+        const size_t acks_before = mock_dfu_get_send_to_host_call_count();
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet_buffer, packet_size));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        while (mock_dfu_flash_op_pending()) {
+            // Nothing is ACKed while the flash is busy
+            CHECK_EQUAL(acks_before, mock_dfu_get_send_to_host_call_count());
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, mock_dfu_complete_flash_op(VOYAGER_ERROR_NONE));
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        }
+
+        CHECK_EQUAL(acks_before + 1U, mock_dfu_get_send_to_host_call_count());
+        const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, voyager_host_compare_ack_message(ack, ack_size, packet_buffer, packet_size));
+        sent_size += payload_size;
+
+        // The host takes a while to send the next packet, long enough for the next sector to be erased
+        if (sent_size < FAKE_FLASH_SIZE) {
+            CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_run());
+        }
+    }
+    mock().enable();
+
+    MEMCMP_EQUAL(fake_flash_data_1, mock_dfu_get_flash(), FAKE_FLASH_SIZE);
+    CHECK_EQUAL(true, voyager_private_get_data()->app_verified_during_dfu);
+}
@@ -0,0 +1,280 @@
+#include <array>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#include "CppUTest/TestHarness.h"
+#include "voyager_host_fleet.hpp"
+
+// create a test group
+TEST_GROUP(test_host_fleet){};
+
+static const size_t FLEET_IMAGE_SIZE = 1000U;
+static const size_t FLEET_MAX_PAYLOAD = 30U;
+static const uint8_t FLEET_WINDOW_SIZE = 4U;
+
+// Plays a target on the other end of the link. Packets are accepted in order and their payloads written to its own flash
+class FakeTargetTransport : public VoyagerHostTransport {
+   public:
+    bool send(const uint8_t *data, size_t len) override {
+        if (unresponsive) {
+            return true;
+        }
+
+        std::array<uint8_t, 8> ack = {VOYAGER_HOST_MESSAGE_ID_ACK, VOYAGER_TARGET_DFU_ERROR_NONE};
+        if (data[0] == VOYAGER_HOST_MESSAGE_ID_START) {
+            flash.clear();
+            next_sequence_number = 0U;
+            ack[6] = std::min<uint8_t>(data[8], FLEET_WINDOW_SIZE);
+        } else if (data[1] == next_sequence_number) {
+            flash.insert(flash.end(), &data[2], &data[len]);
+            next_sequence_number++;
+        } else {
+            ack[1] = VOYAGER_TARGET_DFU_ERROR_OUT_OF_SEQUENCE;
+            ack[2] = next_sequence_number;
+        }
+
+        if (ack[1] == VOYAGER_TARGET_DFU_ERROR_NONE) {
+            const uint32_t crc = voyager_host_calculate_crc(&data[1], len - 1U);
+            ack[2] = (uint8_t)(crc >> 24);
+            ack[3] = (uint8_t)(crc >> 16);
+            ack[4] = (uint8_t)(crc >> 8);
+            ack[5] = (uint8_t)crc;
+        }
+        acks.push_back(ack);
+        return true;
+    }
+
+    size_t receive(uint8_t *buffer, size_t capacity, std::chrono::milliseconds timeout) override {
+        (void)timeout;
+        if (acks.empty() || (capacity < acks.front().size())) {
+            return 0U;
+        }
+
+        memcpy(buffer, acks.front().data(), acks.front().size());
+        acks.pop_front();
+        return 8U;
+    }
+
+    bool unresponsive = false;
+    std::vector<uint8_t> flash;
+
+   private:
+    uint8_t next_sequence_number = 0U;
+    std::deque<std::array<uint8_t, 8>> acks;
+};
+
+static std::vector<uint8_t> make_fleet_image(void) {
+    std::vector<uint8_t> image(FLEET_IMAGE_SIZE);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = (uint8_t)((i * 29U) ^ (i >> 3));
+    }
+    return image;
+}
+
+static VoyagerHostFleetOptions fleet_options(const size_t thread_count) {
+    VoyagerHostFleetOptions options;
+    options.thread_count = thread_count;
+    options.session.window_size = FLEET_WINDOW_SIZE;
+    options.session.max_retries = 1U;
+    options.session.timeout = std::chrono::milliseconds(0);
+    return options;
+}
+
+// Test that the packet table holds the same packets as generating them one at a time
+TEST(test_host_fleet, image_packet_table) {
+    const std::vector<uint8_t> image = make_fleet_image();
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.load(image.data(), image.size(), FLEET_MAX_PAYLOAD));
+
+    CHECK_EQUAL(image.size(), host_image.size());
+    CHECK_EQUAL(voyager_host_calculate_crc(image.data(), image.size()), host_image.crc());
+    CHECK_EQUAL((FLEET_IMAGE_SIZE + FLEET_MAX_PAYLOAD - 1U) / FLEET_MAX_PAYLOAD, host_image.packet_count());
+
+    uint8_t expected[FLEET_MAX_PAYLOAD + 2U] = {0};
+    size_t offset = 0U;
+    for (size_t i = 0; i < host_image.packet_count(); i++) {
+        const size_t payload_size = std::min(FLEET_MAX_PAYLOAD, image.size() - offset);
+        const size_t expected_size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            expected, payload_size + 2U, &image[offset], payload_size, (uint8_t)i);
+        const VoyagerHostPacket packet = host_image.packet(i);
+        CHECK_EQUAL(expected_size, packet.size);
+        CHECK_EQUAL(payload_size, packet.payload_size);
+        CHECK_EQUAL(voyager_host_calculate_crc(&expected[1], expected_size - 1U), packet.ack_crc);
+        MEMCMP_EQUAL(expected, packet.data, expected_size);
+        offset += payload_size;
+    }
+    CHECK_EQUAL(image.size(), offset);
+}
+
+// Test that an image file is mapped rather than read, and that a missing file is reported
+TEST(test_host_fleet, image_open_file) {
+    const std::vector<uint8_t> image = make_fleet_image();
+    const std::string path = (std::filesystem::temp_directory_path() / "voyager_host_fleet_image.bin").string();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(image.data()), (std::streamsize)image.size());
+
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.open(path, FLEET_MAX_PAYLOAD));
+    std::filesystem::remove(path);
+    CHECK_EQUAL(image.size(), host_image.size());
+    MEMCMP_EQUAL(image.data(), host_image.data(), image.size());
+    CHECK_EQUAL(voyager_host_calculate_crc(image.data(), image.size()), host_image.crc());
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR, host_image.open(path, FLEET_MAX_PAYLOAD));
+    CHECK_EQUAL(0U, host_image.size());
+}
+
+// Test that more targets than worker threads are all updated, with progress reported per target and in aggregate
+TEST(test_host_fleet, updates_every_target) {
+    static const size_t target_count = 8U;
+    const std::vector<uint8_t> image = make_fleet_image();
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.load(image.data(), image.size(), FLEET_MAX_PAYLOAD));
+
+    std::vector<FakeTargetTransport> targets(target_count);
+    std::vector<VoyagerHostTransport *> transports;
+    for (FakeTargetTransport &target : targets) {
+        transports.push_back(&target);
+    }
+
+    std::mutex progress_mutex;
+    std::vector<size_t> target_progress(target_count, 0U);
+    VoyagerHostFleetOptions options = fleet_options(3U);
+    options.progress = [&](size_t target, size_t bytes_acked, size_t image_size) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        CHECK(bytes_acked > target_progress[target]);
+        CHECK(bytes_acked <= image_size);
+        target_progress[target] = bytes_acked;
+    };
+    VoyagerHostFleet fleet(host_image, options);
+
+    const VoyagerHostFleetReport report = fleet.flash(transports);
+    CHECK_EQUAL(target_count, report.targets.size());
+    CHECK_EQUAL(0U, report.failures());
+    CHECK_EQUAL(target_count * image.size(), report.bytes_acked);
+    CHECK_EQUAL(report.bytes_acked, fleet.bytes_acked());
+    CHECK(report.bytes_per_second() > 0.0);
+    for (size_t i = 0; i < target_count; i++) {
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, report.targets[i].error);
+        CHECK_EQUAL(0U, report.targets[i].retransmissions);
+        CHECK_EQUAL(image.size(), target_progress[i]);
+        CHECK(targets[i].flash == image);
+    }
+}
+
+// Test that a target that fails does not hold up or fail the rest of the fleet
+TEST(test_host_fleet, failed_target_is_reported_alone) {
+    const std::vector<uint8_t> image = make_fleet_image();
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.load(image.data(), image.size(), FLEET_MAX_PAYLOAD));
+
+    std::vector<FakeTargetTransport> targets(4U);
+    targets[1].unresponsive = true;
+    std::vector<VoyagerHostTransport *> transports;
+    for (FakeTargetTransport &target : targets) {
+        transports.push_back(&target);
+    }
+
+    VoyagerHostFleet fleet(host_image, fleet_options(2U));
+    const VoyagerHostFleetReport report = fleet.flash(transports);
+    CHECK_EQUAL(1U, report.failures());
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_TIMEOUT, report.targets[1].error);
+    CHECK_EQUAL(3U * image.size(), report.bytes_acked);
+    CHECK(targets[0].flash == image);
+    CHECK(targets[2].flash == image);
+    CHECK(targets[3].flash == image);
+}
+
+static std::string write_packet_stream(const std::vector<uint8_t> &image, const char *const name) {
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.load(image.data(), image.size(), FLEET_MAX_PAYLOAD));
+    const std::string path = (std::filesystem::temp_directory_path() / name).string();
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.save_packet_stream(path));
+    return path;
+}
+
+// Test that a packet stream file maps back to the packets and ACK CRCs it was saved from
+TEST(test_host_fleet, packet_stream_round_trip) {
+    const std::vector<uint8_t> image = make_fleet_image();
+    VoyagerHostImage generated;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, generated.load(image.data(), image.size(), FLEET_MAX_PAYLOAD));
+    const std::string path = write_packet_stream(image, "voyager_host_packet_stream.vyps");
+
+    VoyagerHostImage mapped;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, mapped.open_packet_stream(path));
+    std::filesystem::remove(path);
+
+    POINTERS_EQUAL(nullptr, mapped.data());
+    CHECK_EQUAL(generated.size(), mapped.size());
+    CHECK_EQUAL(generated.crc(), mapped.crc());
+    CHECK_EQUAL(FLEET_MAX_PAYLOAD, mapped.max_payload());
+    CHECK_EQUAL(generated.packet_count(), mapped.packet_count());
+    for (size_t i = 0; i < mapped.packet_count(); i++) {
+        const VoyagerHostPacket expected = generated.packet(i);
+        const VoyagerHostPacket packet = mapped.packet(i);
+        CHECK_EQUAL(expected.size, packet.size);
+        CHECK_EQUAL(expected.payload_size, packet.payload_size);
+        CHECK_EQUAL(expected.ack_crc, packet.ack_crc);
+        MEMCMP_EQUAL(expected.data, packet.data, expected.size);
+        CHECK(packet.file_offset > 0U);
+    }
+}
+
+// Test that a packet stream whose header or index does not describe the image is rejected
+TEST(test_host_fleet, packet_stream_rejects_corrupt_file) {
+    static const size_t PACKET_STREAM_IMAGE_SIZE_OFFSET = 8U;
+    static const size_t PACKET_STREAM_HEADER_SIZE = 48U;
+    const std::vector<uint8_t> image = make_fleet_image();
+    const std::string path = write_packet_stream(image, "voyager_host_corrupt_packet_stream.vyps");
+    std::vector<uint8_t> file(std::filesystem::file_size(path));
+    std::ifstream(path, std::ios::binary).read(reinterpret_cast<char *>(file.data()), (std::streamsize)file.size());
+
+    const auto check_rejected = [&path](const std::vector<uint8_t> &contents) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(reinterpret_cast<const char *>(contents.data()), (std::streamsize)contents.size());
+        VoyagerHostImage mapped;
+        CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR, mapped.open_packet_stream(path));
+        CHECK_EQUAL(0U, mapped.packet_count());
+    };
+
+    // Not a packet stream at all
+    check_rejected(image);
+
+    // Packets cut off at the end of the file
+    check_rejected(std::vector<uint8_t>(file.begin(), file.end() - 1));
+
+    // An image size the packets do not add up to
+    std::vector<uint8_t> wrong_size = file;
+    wrong_size[PACKET_STREAM_IMAGE_SIZE_OFFSET]++;
+    check_rejected(wrong_size);
+
+    // The first index entry pointing at the second packet, whose sequence number is out of order
+    std::vector<uint8_t> wrong_order = file;
+    wrong_order[PACKET_STREAM_HEADER_SIZE] = (uint8_t)(wrong_order[PACKET_STREAM_HEADER_SIZE] + FLEET_MAX_PAYLOAD + 2U);
+    check_rejected(wrong_order);
+
+    std::filesystem::remove(path);
+}
+
+// Test that a fleet sends a mapped packet stream, matching every ACK against the CRCs stored in the file
+TEST(test_host_fleet, updates_from_packet_stream) {
+    const std::vector<uint8_t> image = make_fleet_image();
+    const std::string path = write_packet_stream(image, "voyager_host_fleet_packet_stream.vyps");
+    VoyagerHostImage mapped;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, mapped.open_packet_stream(path));
+    std::filesystem::remove(path);
+
+    std::vector<FakeTargetTransport> targets(3U);
+    std::vector<VoyagerHostTransport *> transports;
+    for (FakeTargetTransport &target : targets) {
+        transports.push_back(&target);
+    }
+
+    VoyagerHostFleet fleet(mapped, fleet_options(3U));
+    const VoyagerHostFleetReport report = fleet.flash(transports);
+    CHECK_EQUAL(0U, report.failures());
+    for (const FakeTargetTransport &target : targets) {
+        CHECK(target.flash == image);
+    }
+}
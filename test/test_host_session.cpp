@@ -0,0 +1,233 @@
+#include <CppUTestExt/MockSupport.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+#include "CppUTest/TestHarness.h"
+#include "test_defaults.hpp"
+#include "voyager_host_session.hpp"
+
+extern "C" {
+#include "mock_dfu.h"
+#include "mock_nvm.h"
+#include "voyager.h"
+#include "voyager_private.h"
+}
+
+// create a test group
+TEST_GROUP(test_host_session){void setup(){mock().clear();
+mock().disable();
+mock_nvm_data_t *nvm_data = mock_nvm_get_data();
+nvm_data->app_start_address = (uintptr_t)mock_dfu_get_flash();
+nvm_data->app_end_address = nvm_data->app_start_address + FAKE_FLASH_SIZE;
+nvm_data->app_size = FAKE_FLASH_SIZE;
+mock_dfu_init();
+mock_dfu_enable_flash_emulation(true);
+
+CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_request(VOYAGER_REQUEST_ENTER_DFU));
+}
+
+void teardown() {
+    mock().enable();
+    mock().clear();
+}
+}
+;
+
+// Connects a session directly to the bootloader, running it whenever the host waits for an ACK
+class LoopbackTransport : public VoyagerHostTransport {
+   public:
+    bool send(const uint8_t *data, size_t len) override {
+        const size_t index = packets_sent++;
+        if (!drop_packet || !drop_packet(index, data)) {
+            voyager_bootloader_process_receieved_packet(data, len);
+        }
+        return true;
+    }
+
+    size_t receive(uint8_t *buffer, size_t capacity, std::chrono::milliseconds timeout) override {
+        (void)timeout;
+        for (size_t run = 0; run < RUNS_BEFORE_TIMEOUT; run++) {
+            const size_t acks_before_run = mock_dfu_get_send_to_host_call_count();
+            voyager_bootloader_run();
+            if (mock_dfu_get_send_to_host_call_count() == acks_before_run) {
+                continue;
+            }
+
+            const size_t index = acks_received++;
+            if (drop_ack && drop_ack(index)) {
+                continue;
+            }
+
+            size_t ack_size = 0U;
+            const uint8_t *const ack = mock_dfu_get_last_sent_message(&ack_size);
+            const size_t size = (ack_size < capacity) ? ack_size : capacity;
+            memcpy(buffer, ack, size);
+            return size;
+        }
+
+        timeouts++;
+        return 0U;
+    }
+
+    // Return true to lose a packet on its way to the target, given its index among the packets sent
+    std::function<bool(size_t index, const uint8_t *packet)> drop_packet;
+    // Return true to lose an ACK on its way to the host, given its index among the ACKs sent
+    std::function<bool(size_t index)> drop_ack;
+    size_t packets_sent = 0U;
+    size_t acks_received = 0U;
+    size_t timeouts = 0U;
+
+   private:
+    static constexpr size_t RUNS_BEFORE_TIMEOUT = 16U;
+};
+
+static void make_session_image(uint8_t image[FAKE_FLASH_SIZE]) {
+    for (size_t i = 0; i < FAKE_FLASH_SIZE; i++) {
+        image[i] = (uint8_t)((i * 13U) + 7U);
+    }
+}
+
+static VoyagerHostSessionOptions session_options(const uint8_t window_size) {
+    VoyagerHostSessionOptions options;
+    options.window_size = window_size;
+    options.max_payload = 16U;
+    options.timeout = std::chrono::milliseconds(0);
+    return options;
+}
+
+// Test that an image streamed from a file is written intact with a full window in flight
+TEST(test_host_session, windowed_transfer_from_file) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+    const std::string path = (std::filesystem::temp_directory_path() / "voyager_host_session_image.bin").string();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(image), sizeof(image));
+
+    LoopbackTransport transport;
+    VoyagerHostSessionOptions options = session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH);
+    size_t progress_calls = 0U;
+    size_t last_progress = 0U;
+    options.progress = [&](size_t bytes_acked, size_t image_size) {
+        CHECK_EQUAL(sizeof(image), image_size);
+        CHECK(bytes_acked > last_progress);
+        last_progress = bytes_acked;
+        progress_calls++;
+    };
+    VoyagerHostSession session(transport, options);
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, session.flash_file(path));
+    std::filesystem::remove(path);
+
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, session.granted_window_size());
+    CHECK_EQUAL(0U, session.retransmissions());
+    CHECK_EQUAL(0U, transport.timeouts);
+    CHECK_EQUAL(sizeof(image), last_progress);
+    CHECK_EQUAL((sizeof(image) + options.max_payload - 1U) / options.max_payload, progress_calls);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+}
+
+// Test that a DATA packet lost inside the window is recovered by going back to it
+TEST(test_host_session, lost_packet_goes_back) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+
+    LoopbackTransport transport;
+    bool dropped = false;
+    transport.drop_packet = [&](size_t index, const uint8_t *packet) {
+        // Lose the third DATA packet the first time it is sent
+        const bool drop = !dropped && (packet[0] == VOYAGER_HOST_MESSAGE_ID_DATA) && (packet[1] == 2U) && (index > 0U);
+        dropped = dropped || drop;
+        return drop;
+    };
+    VoyagerHostSession session(transport, session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH));
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, session.flash_buffer(image, sizeof(image)));
+    CHECK_EQUAL(true, dropped);
+    CHECK(session.retransmissions() > 0U);
+    CHECK_EQUAL(0U, transport.timeouts);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+}
+
+// Test that a lost ACK is covered by the ACK of a later packet without resending anything
+TEST(test_host_session, lost_ack_is_covered_by_later_ack) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+
+    LoopbackTransport transport;
+    // Lose the ACK of the second DATA packet, the START ACK being the first ACK
+    transport.drop_ack = [](size_t index) { return index == 2U; };
+    VoyagerHostSession session(transport, session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH));
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, session.flash_buffer(image, sizeof(image)));
+    CHECK_EQUAL(0U, session.retransmissions());
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+}
+
+// Test that stop-and-wait recovers a lost DATA packet by resending it once the ACK times out
+TEST(test_host_session, stop_and_wait_resends_after_timeout) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+
+    LoopbackTransport transport;
+    bool dropped = false;
+    transport.drop_packet = [&](size_t index, const uint8_t *packet) {
+        const bool drop = !dropped && (packet[0] == VOYAGER_HOST_MESSAGE_ID_DATA) && (index > 3U);
+        dropped = dropped || drop;
+        return drop;
+    };
+    VoyagerHostSession session(transport, session_options(1U));
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, session.flash_buffer(image, sizeof(image)));
+    CHECK_EQUAL(1U, session.granted_window_size());
+    CHECK_EQUAL(1U, session.retransmissions());
+    CHECK_EQUAL(1U, transport.timeouts);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+}
+
+// Test that a target that never answers fails the DFU once the retries are used up
+TEST(test_host_session, unresponsive_target_times_out) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+
+    LoopbackTransport transport;
+    transport.drop_packet = [](size_t index, const uint8_t *packet) {
+        (void)index;
+        (void)packet;
+        return true;
+    };
+    VoyagerHostSessionOptions options = session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH);
+    VoyagerHostSession session(transport, options);
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_TIMEOUT, session.flash_buffer(image, sizeof(image)));
+    CHECK_EQUAL(options.max_retries + 1U, transport.packets_sent);
+}
+
+// Test that an error reported by the target ends the DFU with that error
+TEST(test_host_session, target_error_is_returned) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_init(&default_test_config));
+
+    LoopbackTransport transport;
+    VoyagerHostSession session(transport, session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH));
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_ENTER_DFU_NOT_REQUESTED, session.flash_buffer(image, sizeof(image)));
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR, session.flash_file("does/not/exist.bin"));
+}
+
+// Test that an image whose packets were generated ahead of time is sent straight from its packet table
+TEST(test_host_session, transfer_from_packet_table) {
+    uint8_t image[FAKE_FLASH_SIZE] = {0};
+    make_session_image(image);
+    VoyagerHostImage host_image;
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, host_image.load(image, sizeof(image), 20U));
+
+    LoopbackTransport transport;
+    VoyagerHostSession session(transport, session_options(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH));
+
+    CHECK_EQUAL(VOYAGER_HOST_DFU_ERROR_NONE, session.flash_image(host_image));
+    CHECK_EQUAL(1U + host_image.packet_count(), transport.packets_sent);
+    MEMCMP_EQUAL(image, mock_dfu_get_flash(), sizeof(image));
+}
@@ -0,0 +1,178 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "CppUTest/TestHarness.h"
+#include "test_defaults.hpp"
+
+extern "C" {
+#include "voyager.h"
+#include "voyager_private.h"
+}
+
+extern const voyager_bootloader_config_t default_test_config;
+
+// create a test group
+TEST_GROUP(test_rx_queue){void setup(){voyager_bootloader_init(&default_test_config);
+}
+}
+;
+
+static const size_t STRESS_PACKET_COUNT = 200000U;
+
+// Each packet's size and contents are derived from its index, so a lost, reordered or torn packet is detectable
+static size_t stress_packet_size(size_t index) { return 1U + (index % VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE); }
+
+static uint8_t stress_packet_byte(size_t index, size_t offset) { return (uint8_t)((index * 31U) + (offset * 7U)); }
+
+// Plays the role of the transport interrupt, enqueueing packets as soon as there is space for them
+static void *stress_producer(void *arg) {
+    (void)arg;
+    uint8_t packet[VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE];
+    for (size_t index = 0; index < STRESS_PACKET_COUNT; index++) {
+        const size_t size = stress_packet_size(index);
+        for (size_t offset = 0; offset < size; offset++) {
+            packet[offset] = stress_packet_byte(index, offset);
+        }
+
+        while (voyager_private_rx_queue_count() >= VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH) {
+            sched_yield();
+        }
+        voyager_bootloader_process_receieved_packet(packet, size);
+    }
+    return NULL;
+}
+
+// Test that packets enqueued from one thread are dequeued intact and in order by another
+TEST(test_rx_queue, test_spsc_stress) {
+    pthread_t producer;
+    CHECK_EQUAL(0, pthread_create(&producer, NULL, stress_producer, NULL));
+
+    size_t received = 0U;
+    size_t torn_packets = 0U;
+    while (received < STRESS_PACKET_COUNT) {
+        voyager_rx_slot_t *const slot = voyager_private_rx_queue_peek();
+        if (slot == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        bool intact = (slot->size == stress_packet_size(received));
+        for (size_t offset = 0; intact && (offset < slot->size); offset++) {
+            intact = (slot->buffer[offset] == stress_packet_byte(received, offset));
+        }
+        if (intact == false) {
+            torn_packets++;
+        }
+
+        voyager_private_rx_queue_pop();
+        received++;
+    }
+
+    CHECK_EQUAL(0, pthread_join(producer, NULL));
+    CHECK_EQUAL(0U, torn_packets);
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+}
+
+// Test that a packet arriving while the queue is full is reported as an overrun without disturbing queued packets
+TEST(test_rx_queue, test_overrun_keeps_queued_packets) {
+    uint8_t packet[8] = {0};
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        packet[0] = (uint8_t)i;
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+    }
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+
+    packet[0] = 0xFFU;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+    CHECK_EQUAL(true, voyager_private_rx_queue_overrun());
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH, voyager_private_rx_queue_count());
+    CHECK_EQUAL(0U, voyager_private_rx_queue_peek()->buffer[0]);
+
+    voyager_private_rx_queue_clear_overrun();
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+}
+
+// Test that an overrun is still reported after as many drops as the overrun count can hold
+TEST(test_rx_queue, test_overrun_count_does_not_wrap) {
+    uint8_t packet[8] = {0};
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+    }
+
+    for (size_t i = 0; i < 1024U; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+        CHECK_EQUAL(true, voyager_private_rx_queue_overrun());
+    }
+
+    voyager_private_rx_queue_clear_overrun();
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_process_receieved_packet(packet, sizeof(packet)));
+    CHECK_EQUAL(true, voyager_private_rx_queue_overrun());
+}
+
+// Test that a packet received into a lent buffer is queued in place without a copy
+TEST(test_rx_queue, test_acquire_commit_is_zero_copy) {
+    uint8_t *buffer = NULL;
+    size_t capacity = 0U;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_acquire_rx_buffer(&buffer, &capacity));
+    CHECK(buffer != NULL);
+    CHECK_EQUAL(VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE, capacity);
+
+    // Nothing is queued until the packet is committed, and re-acquiring lends the same buffer
+    uint8_t *reacquired_buffer = NULL;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_acquire_rx_buffer(&reacquired_buffer, &capacity));
+    POINTERS_EQUAL(buffer, reacquired_buffer);
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+
+    buffer[0] = 0x5AU;
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_commit_rx(1U));
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
+    POINTERS_EQUAL(buffer, voyager_private_rx_queue_peek()->buffer);
+    CHECK_EQUAL(1U, voyager_private_rx_queue_peek()->size);
+    CHECK_EQUAL(0x5AU, voyager_private_rx_queue_peek()->buffer[0]);
+}
+
+// Test that no buffer is lent while the queue is full, and that this is not reported as an overrun
+TEST(test_rx_queue, test_acquire_when_full) {
+    uint8_t *buffer = NULL;
+    size_t capacity = 0U;
+    for (size_t i = 0; i < VOYAGER_BOOTLOADER_RX_QUEUE_DEPTH; i++) {
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_acquire_rx_buffer(&buffer, &capacity));
+        CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_commit_rx(capacity));
+    }
+
+    CHECK_EQUAL(VOYAGER_ERROR_BUFFER_FULL, voyager_bootloader_acquire_rx_buffer(&buffer, &capacity));
+    POINTERS_EQUAL(NULL, buffer);
+    CHECK_EQUAL(0U, capacity);
+    CHECK_EQUAL(VOYAGER_ERROR_BUFFER_FULL, voyager_bootloader_commit_rx(1U));
+    CHECK_EQUAL(false, voyager_private_rx_queue_overrun());
+
+    // Processing a packet frees a buffer again
+    voyager_private_rx_queue_pop();
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_acquire_rx_buffer(&buffer, &capacity));
+}
+
+// Test that invalid arguments are rejected by the zero-copy receive API
+TEST(test_rx_queue, test_acquire_commit_invalid_arguments) {
+    uint8_t *buffer = NULL;
+    size_t capacity = 0U;
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_acquire_rx_buffer(NULL, &capacity));
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_acquire_rx_buffer(&buffer, NULL));
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_commit_rx(VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE + 1U));
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+}
+
+// Test that a commit without a preceding acquire is rejected rather than queueing a stale buffer
+TEST(test_rx_queue, test_commit_without_acquire) {
+    uint8_t *buffer = NULL;
+    size_t capacity = 0U;
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_commit_rx(1U));
+    CHECK_EQUAL(0U, voyager_private_rx_queue_count());
+
+    // Each acquire allows exactly one commit
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_acquire_rx_buffer(&buffer, &capacity));
+    CHECK_EQUAL(VOYAGER_ERROR_NONE, voyager_bootloader_commit_rx(1U));
+    CHECK_EQUAL(VOYAGER_ERROR_INVALID_ARGUMENT, voyager_bootloader_commit_rx(1U));
+    CHECK_EQUAL(1U, voyager_private_rx_queue_count());
+}
@@ -0,0 +1,51 @@
+/**
+ * @file voyager_packet_stream.cpp
+ * @brief Converts a firmware binary into a packet stream file, see voyager_host_image.hpp
+ *
+ * Usage: voyager_packet_stream <image> <packet stream> [max payload]
+ *
+ * The max payload is the number of image bytes carried by each DATA packet, i.e. the target's
+ * VOYAGER_BOOTLOADER_MAX_RECEIVE_PACKET_SIZE less 2. It defaults to 62.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "voyager_host_image.hpp"
+
+int main(int argc, char **argv) {
+    static const size_t DEFAULT_MAX_PAYLOAD = 62U;
+
+    if ((argc < 3) || (argc > 4)) {
+        fprintf(stderr, "usage: %s <image> <packet stream> [max payload]\n", argv[0]);
+        return 1;
+    }
+
+    size_t max_payload = DEFAULT_MAX_PAYLOAD;
+    if (argc == 4) {
+        char *end = nullptr;
+        max_payload = strtoul(argv[3], &end, 0);
+        if ((*end != '\0') || (max_payload == 0U)) {
+            fprintf(stderr, "invalid max payload: %s\n", argv[3]);
+            return 1;
+        }
+    }
+
+    VoyagerHostImage image;
+    voyager_host_dfu_error_E error = image.open(argv[1], max_payload);
+    if (error != VOYAGER_HOST_DFU_ERROR_NONE) {
+        fprintf(stderr, "cannot read %s (error %d)\n", argv[1], (int)error);
+        return 1;
+    }
+
+    error = image.save_packet_stream(argv[2]);
+    if (error != VOYAGER_HOST_DFU_ERROR_NONE) {
+        fprintf(stderr, "cannot write %s (error %d)\n", argv[2], (int)error);
+        return 1;
+    }
+
+    printf("%s: %zu bytes, CRC 0x%08x, %zu packets of up to %zu bytes\n", argv[2], image.size(), (unsigned)image.crc(),
+           image.packet_count(), max_payload);
+    return 0;
+}
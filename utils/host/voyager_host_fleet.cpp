@@ -0,0 +1,66 @@
+/**
+ * @file voyager_host_fleet.cpp
+ * @brief Updates many targets with the same image in parallel from one host process
+ */
+
+#include "voyager_host_fleet.hpp"
+
+#include <algorithm>
+#include <thread>
+
+size_t VoyagerHostFleetReport::failures() const {
+    return (size_t)std::count_if(targets.begin(), targets.end(), [](const VoyagerHostFleetResult &result) {
+        return result.error != VOYAGER_HOST_DFU_ERROR_NONE;
+    });
+}
+
+VoyagerHostFleet::VoyagerHostFleet(const VoyagerHostImage &image, const VoyagerHostFleetOptions &options)
+    : image_(image), options_(options) {}
+
+VoyagerHostFleetReport VoyagerHostFleet::flash(const std::vector<VoyagerHostTransport *> &transports) {
+    VoyagerHostFleetReport report;
+    report.targets.resize(transports.size());
+    next_target_.store(0U);
+    bytes_acked_.store(0U);
+
+    size_t thread_count = (options_.thread_count > 0U) ? options_.thread_count : std::thread::hardware_concurrency();
+    thread_count = std::min(std::max<size_t>(thread_count, 1U), transports.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    workers.reserve(thread_count);
+    for (size_t i = 0U; i < thread_count; i++) {
+        workers.emplace_back(&VoyagerHostFleet::run_worker, this, std::cref(transports), std::ref(report.targets));
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    report.bytes_acked = bytes_acked_.load();
+    return report;
+}
+
+void VoyagerHostFleet::run_worker(const std::vector<VoyagerHostTransport *> &transports,
+                                  std::vector<VoyagerHostFleetResult> &results) {
+    // Each worker takes the next target nobody has started on until there are none left, so a slow target only
+    // holds up its own worker
+    for (size_t target = next_target_.fetch_add(1U); target < transports.size(); target = next_target_.fetch_add(1U)) {
+        size_t target_bytes_acked = 0U;
+        VoyagerHostSessionOptions session_options = options_.session;
+        session_options.progress = [this, target, &target_bytes_acked](size_t bytes_acked, size_t image_size) {
+            bytes_acked_.fetch_add(bytes_acked - target_bytes_acked, std::memory_order_relaxed);
+            target_bytes_acked = bytes_acked;
+            if (options_.progress) {
+                options_.progress(target, bytes_acked, image_size);
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        VoyagerHostSession session(*transports[target], session_options);
+        VoyagerHostFleetResult &result = results[target];
+        result.error = session.flash_image(image_);
+        result.retransmissions = session.retransmissions();
+        result.elapsed = std::chrono::steady_clock::now() - start;
+    }
+}
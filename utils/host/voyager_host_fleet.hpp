@@ -0,0 +1,105 @@
+/**
+ * @file voyager_host_fleet.hpp
+ * @brief Updates many targets with the same image in parallel from one host process
+ *
+ * Each target gets its own VoyagerHostSession, and the sessions are run by a pool of worker threads.
+ * Every session sends from the same read-only VoyagerHostImage, so the image is mapped and its packets
+ * generated once however many targets are updated.
+ */
+
+#ifndef VOYAGER_HOST_FLEET_HPP
+#define VOYAGER_HOST_FLEET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "voyager_host_image.hpp"
+#include "voyager_host_session.hpp"
+
+/**
+ * @brief Options of a VoyagerHostFleet
+ */
+struct VoyagerHostFleetOptions {
+    /// @brief Options of the session run for each target. Their progress callback is not used
+    VoyagerHostSessionOptions session;
+    /// @brief Number of targets updated at once, 0 to use one per hardware thread
+    size_t thread_count = 0U;
+    /// @brief Called with the index of a target, the number of bytes it has acknowledged and the size of the image.
+    /// Called from the worker threads, so it must be thread safe
+    std::function<void(size_t target, size_t bytes_acked, size_t image_size)> progress;
+};
+
+/**
+ * @brief Outcome of the DFU of one target
+ */
+struct VoyagerHostFleetResult {
+    /// @brief VOYAGER_HOST_DFU_ERROR_NONE if every byte of the image was acknowledged, otherwise an error code
+    voyager_host_dfu_error_E error = VOYAGER_HOST_DFU_ERROR_NONE;
+    /// @brief Number of DATA packets sent more than once
+    size_t retransmissions = 0U;
+    /// @brief Time taken by the DFU
+    std::chrono::duration<double> elapsed{0.0};
+};
+
+/**
+ * @brief Outcome of the DFUs of a fleet
+ */
+struct VoyagerHostFleetReport {
+    /// @brief The outcome of each target, in the order the transports were given
+    std::vector<VoyagerHostFleetResult> targets;
+    /// @brief Number of image bytes acknowledged by all targets together
+    size_t bytes_acked = 0U;
+    /// @brief Time taken to update every target
+    std::chrono::duration<double> elapsed{0.0};
+
+    /**
+     * @brief Gets the aggregate throughput of the fleet
+     * @return The number of image bytes acknowledged per second by all targets together
+     */
+    double bytes_per_second() const { return (elapsed.count() > 0.0) ? (double)bytes_acked / elapsed.count() : 0.0; }
+
+    /**
+     * @brief Counts the targets that were not updated
+     * @return The number of targets whose DFU failed
+     */
+    size_t failures() const;
+};
+
+/**
+ * @brief Runs DFUs of many targets with the same image
+ */
+class VoyagerHostFleet {
+   public:
+    /**
+     * @brief Creates a fleet updater
+     * @param image The image to send, which must outlive the fleet updater
+     * @param options The options of the fleet updater
+     */
+    explicit VoyagerHostFleet(const VoyagerHostImage &image, const VoyagerHostFleetOptions &options = {});
+
+    /**
+     * @brief Updates every target, returning once all of them have finished
+     * @param transports The link to each target. No two may share a link
+     * @return The outcome of each target and of the fleet as a whole
+     */
+    VoyagerHostFleetReport flash(const std::vector<VoyagerHostTransport *> &transports);
+
+    /**
+     * @brief Gets the number of image bytes acknowledged so far by all targets together
+     * @return The number of bytes, which may be read from any thread while flash is running
+     */
+    size_t bytes_acked() const { return bytes_acked_.load(std::memory_order_relaxed); }
+
+   private:
+    void run_worker(const std::vector<VoyagerHostTransport *> &transports, std::vector<VoyagerHostFleetResult> &results);
+
+    const VoyagerHostImage &image_;
+    VoyagerHostFleetOptions options_;
+    std::atomic<size_t> next_target_{0U};
+    std::atomic<size_t> bytes_acked_{0U};
+};
+
+#endif  // VOYAGER_HOST_FLEET_HPP
@@ -0,0 +1,239 @@
+/**
+ * @file voyager_host_image.cpp
+ * @brief Read-only application image with its DATA packets generated ahead of time
+ */
+
+#include "voyager_host_image.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+// Packet stream file layout, see voyager_host_image.hpp
+constexpr std::array<uint8_t, 4> PACKET_STREAM_MAGIC = {'V', 'Y', 'P', 'S'};
+constexpr size_t PACKET_STREAM_VERSION_OFFSET = 4U;
+constexpr size_t PACKET_STREAM_IMAGE_SIZE_OFFSET = 8U;
+constexpr size_t PACKET_STREAM_IMAGE_CRC_OFFSET = 12U;
+constexpr size_t PACKET_STREAM_MAX_PAYLOAD_OFFSET = 16U;
+constexpr size_t PACKET_STREAM_PACKET_COUNT_OFFSET = 20U;
+constexpr size_t PACKET_STREAM_INDEX_OFFSET_OFFSET = 24U;
+constexpr size_t PACKET_STREAM_PACKETS_OFFSET_OFFSET = 28U;
+constexpr size_t PACKET_STREAM_HEADER_SIZE = 48U;
+constexpr size_t PACKET_STREAM_INDEX_ENTRY_SIZE = 12U;
+
+uint32_t read_le32(const uint8_t *const buffer) {
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+void write_le32(uint8_t *const buffer, const size_t value) {
+    for (size_t i = 0U; i < 4U; i++) {
+        buffer[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+}  // namespace
+
+VoyagerHostImage::~VoyagerHostImage() { unmap(); }
+
+voyager_host_dfu_error_E VoyagerHostImage::open(const std::string &path, size_t max_payload) {
+    voyager_host_dfu_error_E ret = map_file(path);
+    if (ret == VOYAGER_HOST_DFU_ERROR_NONE) {
+        ret = generate_packets(static_cast<const uint8_t *>(mapping_), mapping_size_, max_payload);
+    }
+    if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+        unmap();
+    }
+
+    return ret;
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::open_packet_stream(const std::string &path) {
+    voyager_host_dfu_error_E ret = map_file(path);
+    if (ret == VOYAGER_HOST_DFU_ERROR_NONE) {
+        ret = read_packet_stream();
+    }
+    if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+        unmap();
+    }
+
+    return ret;
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::load(const uint8_t *image, size_t size, size_t max_payload) {
+    unmap();
+    if ((image == nullptr) && (size > 0U)) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    return generate_packets(image, size, max_payload);
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::save_packet_stream(const std::string &path) const {
+    const size_t index_offset = PACKET_STREAM_HEADER_SIZE;
+    const size_t packets_offset = index_offset + (index_.size() * PACKET_STREAM_INDEX_ENTRY_SIZE);
+
+    std::vector<uint8_t> header(packets_offset, 0U);
+    std::copy(PACKET_STREAM_MAGIC.begin(), PACKET_STREAM_MAGIC.end(), header.begin());
+    write_le32(&header[PACKET_STREAM_VERSION_OFFSET], VOYAGER_HOST_PACKET_STREAM_VERSION);
+    write_le32(&header[PACKET_STREAM_IMAGE_SIZE_OFFSET], size_);
+    write_le32(&header[PACKET_STREAM_IMAGE_CRC_OFFSET], crc_);
+    write_le32(&header[PACKET_STREAM_MAX_PAYLOAD_OFFSET], max_payload_);
+    write_le32(&header[PACKET_STREAM_PACKET_COUNT_OFFSET], index_.size());
+    write_le32(&header[PACKET_STREAM_INDEX_OFFSET_OFFSET], index_offset);
+    write_le32(&header[PACKET_STREAM_PACKETS_OFFSET_OFFSET], packets_offset);
+
+    // Packets are written back to back in order, so each one starts where the previous one ends
+    size_t file_offset = packets_offset;
+    for (size_t i = 0U; i < index_.size(); i++) {
+        uint8_t *const entry = &header[index_offset + (i * PACKET_STREAM_INDEX_ENTRY_SIZE)];
+        write_le32(&entry[0], file_offset);
+        write_le32(&entry[4], index_[i].size);
+        write_le32(&entry[8], index_[i].ack_crc);
+        file_offset += index_[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(header.data()), (std::streamsize)header.size());
+    for (const PacketIndexEntry &entry : index_) {
+        file.write(reinterpret_cast<const char *>(&packets_[entry.offset]), (std::streamsize)entry.size);
+    }
+    file.close();
+
+    return file ? VOYAGER_HOST_DFU_ERROR_NONE : VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+}
+
+VoyagerHostPacket VoyagerHostImage::packet(size_t index) const {
+    const PacketIndexEntry &entry = index_[index];
+    return VoyagerHostPacket{&packets_[entry.offset], entry.size, entry.size - VOYAGER_HOST_DATA_PACKET_OVERHEAD, entry.ack_crc,
+                             packets_mapped_ ? entry.offset : 0U};
+}
+
+void VoyagerHostImage::unmap(void) {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+    mapping_ = nullptr;
+    mapping_size_ = 0U;
+    data_ = nullptr;
+    size_ = 0U;
+    crc_ = 0U;
+    max_payload_ = 0U;
+    packet_storage_.clear();
+    packets_ = nullptr;
+    packets_mapped_ = false;
+    index_.clear();
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::map_file(const std::string &path) {
+    unmap();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        ret = VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    } else if (file_stat.st_size > 0) {
+        // The mapping stays valid once the file is closed
+        void *const mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ret = VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+        } else {
+            mapping_ = mapping;
+            mapping_size_ = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    ::close(fd);
+
+    return ret;
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::generate_packets(const uint8_t *image, size_t size, size_t max_payload) {
+    if ((max_payload == 0U) || (size > VOYAGER_HOST_MAX_APP_SIZE)) {
+        return VOYAGER_HOST_DFU_ERROR_SIZE_TOO_LARGE;
+    }
+
+    data_ = image;
+    size_ = size;
+    crc_ = voyager_host_calculate_crc(image, size);
+    max_payload_ = max_payload;
+
+    const size_t count = (size_ + max_payload - 1U) / max_payload;
+    packet_storage_.resize(size_ + (count * VOYAGER_HOST_DATA_PACKET_OVERHEAD));
+    packets_ = packet_storage_.data();
+    index_.reserve(count);
+
+    voyager_host_generator_context_t context;
+    voyager_host_generator_context_init(&context);
+    if ((count > 0U) && (voyager_host_message_generator_generate_data_packets(&context, packet_storage_.data(),
+                                                                              packet_storage_.size(), data_, size_,
+                                                                              max_payload, count) != packet_storage_.size())) {
+        return VOYAGER_HOST_DFU_ERROR_INTERNAL_ERROR;
+    }
+
+    // Every packet but the last carries max_payload bytes, so they all start at a multiple of the full packet size
+    for (size_t index = 0U; index < count; index++) {
+        const size_t offset = index * (max_payload + VOYAGER_HOST_DATA_PACKET_OVERHEAD);
+        const size_t packet_size = std::min(max_payload + VOYAGER_HOST_DATA_PACKET_OVERHEAD, packet_storage_.size() - offset);
+
+        // The target acknowledges a DATA packet with the CRC of everything after its message ID
+        const uint32_t ack_crc = voyager_host_calculate_crc(&packet_storage_[offset + 1U], packet_size - 1U);
+        index_.push_back(PacketIndexEntry{offset, packet_size, ack_crc});
+    }
+
+    return VOYAGER_HOST_DFU_ERROR_NONE;
+}
+
+voyager_host_dfu_error_E VoyagerHostImage::read_packet_stream(void) {
+    const uint8_t *const file = static_cast<const uint8_t *>(mapping_);
+    if ((mapping_size_ < PACKET_STREAM_HEADER_SIZE) ||
+        !std::equal(PACKET_STREAM_MAGIC.begin(), PACKET_STREAM_MAGIC.end(), file) ||
+        (read_le32(&file[PACKET_STREAM_VERSION_OFFSET]) != VOYAGER_HOST_PACKET_STREAM_VERSION)) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    const size_t image_size = read_le32(&file[PACKET_STREAM_IMAGE_SIZE_OFFSET]);
+    const size_t max_payload = read_le32(&file[PACKET_STREAM_MAX_PAYLOAD_OFFSET]);
+    const size_t packet_count = read_le32(&file[PACKET_STREAM_PACKET_COUNT_OFFSET]);
+    const size_t index_offset = read_le32(&file[PACKET_STREAM_INDEX_OFFSET_OFFSET]);
+    if ((image_size > VOYAGER_HOST_MAX_APP_SIZE) || (max_payload == 0U) || (index_offset > mapping_size_) ||
+        (packet_count > ((mapping_size_ - index_offset) / PACKET_STREAM_INDEX_ENTRY_SIZE))) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    // Check that every packet lies inside the file, and that together they carry the image in order
+    size_t payload_total = 0U;
+    index_.reserve(packet_count);
+    for (size_t i = 0U; i < packet_count; i++) {
+        const uint8_t *const entry = &file[index_offset + (i * PACKET_STREAM_INDEX_ENTRY_SIZE)];
+        const size_t offset = read_le32(&entry[0]);
+        const size_t size = read_le32(&entry[4]);
+        if ((offset > mapping_size_) || (size > (mapping_size_ - offset)) || (size < VOYAGER_HOST_DATA_PACKET_OVERHEAD) ||
+            (size > (max_payload + VOYAGER_HOST_DATA_PACKET_OVERHEAD)) || (file[offset] != VOYAGER_HOST_MESSAGE_ID_DATA) ||
+            (file[offset + 1U] != (uint8_t)i)) {
+            return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+        }
+
+        payload_total += size - VOYAGER_HOST_DATA_PACKET_OVERHEAD;
+        index_.push_back(PacketIndexEntry{offset, size, read_le32(&entry[8])});
+    }
+    if (payload_total != image_size) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    size_ = image_size;
+    crc_ = read_le32(&file[PACKET_STREAM_IMAGE_CRC_OFFSET]);
+    max_payload_ = max_payload;
+    packets_ = file;
+    packets_mapped_ = true;
+    return VOYAGER_HOST_DFU_ERROR_NONE;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file voyager_host_image.hpp
+ * @brief Read-only application image with its DATA packets generated ahead of time
+ *
+ * DATA packets carry sequence numbers counting up from 0 in every DFU, so the packets of an image are the
+ * same for every target it is sent to. A VoyagerHostImage generates them once, into a single table, and is
+ * never modified afterwards, so any number of sessions may send from it at once from different threads.
+ *
+ * The table can be saved as a packet stream file and memory mapped again later, so neither the packets nor
+ * the CRCs expected in their ACKs are recalculated for each flash. The START request is not stored, each
+ * session builds its own with the window and flags it negotiates. A packet stream file is laid out as
+ * follows, with every integer stored as 4 little-endian bytes and every offset counted from the start of
+ * the file:
+ *
+ * | Offset | Contents                                                                     |
+ * |--------|------------------------------------------------------------------------------|
+ * | 0      | "VYPS"                                                                       |
+ * | 4      | Format version, VOYAGER_HOST_PACKET_STREAM_VERSION                           |
+ * | 8      | Image size                                                                   |
+ * | 12     | Image CRC                                                                    |
+ * | 16     | Largest payload of a DATA packet                                             |
+ * | 20     | Number of DATA packets                                                       |
+ * | 24     | Offset of the packet index                                                   |
+ * | 28     | Offset of the first DATA packet                                              |
+ * | 32     | Reserved, 0 (16 bytes)                                                       |
+ * | index  | For each DATA packet: its offset, its size and the CRC expected in its ACK   |
+ * | data   | The DATA packets, back to back                                               |
+ */
+
+#ifndef VOYAGER_HOST_IMAGE_HPP
+#define VOYAGER_HOST_IMAGE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "voyager_host_message_generator.h"
+
+/// @brief Version of the packet stream file format written by VoyagerHostImage::save_packet_stream
+#define VOYAGER_HOST_PACKET_STREAM_VERSION 1U
+
+/**
+ * @brief A DATA packet of an image
+ */
+struct VoyagerHostPacket {
+    /// @brief The packet, ready to be sent
+    const uint8_t *data;
+    /// @brief The size of the packet
+    size_t size;
+    /// @brief The number of image bytes carried by the packet
+    size_t payload_size;
+    /// @brief The CRC the target reports in the ACK of the packet, see voyager_host_compare_ack_crc
+    uint32_t ack_crc;
+    /// @brief The offset of the packet in the packet stream file it was mapped from, 0 otherwise
+    size_t file_offset;
+};
+
+/**
+ * @brief An application image and its packet table
+ */
+class VoyagerHostImage {
+   public:
+    VoyagerHostImage() = default;
+    ~VoyagerHostImage();
+    VoyagerHostImage(const VoyagerHostImage &) = delete;
+    VoyagerHostImage &operator=(const VoyagerHostImage &) = delete;
+
+    /**
+     * @brief Memory maps an image file and generates its packets
+     * @param path The path of the image
+     * @param max_payload The number of image bytes carried by each DATA packet
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if successful, otherwise an error code
+     */
+    voyager_host_dfu_error_E open(const std::string &path, size_t max_payload);
+
+    /**
+     * @brief Memory maps a packet stream file written by save_packet_stream
+     * @param path The path of the packet stream
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if successful, otherwise an error code
+     * @note The packets are sent straight out of the mapping. Their layout and sequence numbers are checked
+     * when the file is opened, but their CRCs are not, the target checks the CRC of the whole image instead
+     */
+    voyager_host_dfu_error_E open_packet_stream(const std::string &path);
+
+    /**
+     * @brief Generates the packets of an image held in memory
+     * @param image The image, which must outlive this object
+     * @param size The size of the image
+     * @param max_payload The number of image bytes carried by each DATA packet
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if successful, otherwise an error code
+     */
+    voyager_host_dfu_error_E load(const uint8_t *image, size_t size, size_t max_payload);
+
+    /**
+     * @brief Writes the packet table to a packet stream file
+     * @param path The path of the packet stream
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if successful, otherwise an error code
+     */
+    voyager_host_dfu_error_E save_packet_stream(const std::string &path) const;
+
+    /**
+     * @brief Gets the image
+     * @return The first byte of the image, nullptr if it was opened from a packet stream
+     */
+    const uint8_t *data() const { return data_; }
+
+    /**
+     * @brief Gets the size of the image
+     * @return The size of the image in bytes
+     */
+    size_t size() const { return size_; }
+
+    /**
+     * @brief Gets the CRC of the image
+     * @return The CRC sent in the START request
+     */
+    uint32_t crc() const { return crc_; }
+
+    /**
+     * @brief Gets the largest payload of the image's DATA packets
+     * @return The number of image bytes carried by every DATA packet but the last
+     */
+    size_t max_payload() const { return max_payload_; }
+
+    /**
+     * @brief Gets the number of DATA packets the image is sent in
+     * @return The number of packets
+     */
+    size_t packet_count() const { return index_.size(); }
+
+    /**
+     * @brief Gets a DATA packet of the image
+     * @param index The index of the packet, its sequence number being the index modulo 256
+     * @return The packet
+     */
+    VoyagerHostPacket packet(size_t index) const;
+
+   private:
+    /// @brief Where a packet is and what its ACK should hold
+    struct PacketIndexEntry {
+        size_t offset;
+        size_t size;
+        uint32_t ack_crc;
+    };
+
+    void unmap(void);
+    voyager_host_dfu_error_E map_file(const std::string &path);
+    voyager_host_dfu_error_E generate_packets(const uint8_t *image, size_t size, size_t max_payload);
+    voyager_host_dfu_error_E read_packet_stream(void);
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0U;
+    uint32_t crc_ = 0U;
+    size_t max_payload_ = 0U;
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0U;
+
+    // Generated packets are stored back to back, mapped ones are read straight out of the mapping
+    std::vector<uint8_t> packet_storage_;
+    const uint8_t *packets_ = nullptr;
+    bool packets_mapped_ = false;
+    std::vector<PacketIndexEntry> index_;
+};
+
+#endif  // VOYAGER_HOST_IMAGE_HPP
@@ -19,6 +19,8 @@ typedef enum {
     VOYAGER_HOST_MESSAGE_ID_START,
     VOYAGER_HOST_MESSAGE_ID_ACK,
     VOYAGER_HOST_MESSAGE_ID_DATA,
+    VOYAGER_HOST_MESSAGE_ID_FILL,
+    VOYAGER_HOST_MESSAGE_ID_QUERY,
 } voyager_host_message_id_E;
 
 typedef enum {
@@ -29,6 +31,11 @@ typedef enum {
     VOYAGER_TARGET_DFU_ERROR_INVALID_MESSAGE_ID,
     VOYAGER_TARGET_DFU_ERROR_SIZE_TOO_LARGE,
     VOYAGER_TARGET_DFU_ERROR_INTERNAL_ERROR,
+    VOYAGER_TARGET_DFU_ERROR_UNSUPPORTED_FEATURE,
+    VOYAGER_TARGET_DFU_ERROR_INVALID_COMPRESSED_DATA,
+    VOYAGER_TARGET_DFU_ERROR_BASE_IMAGE_MISMATCH,
+    VOYAGER_TARGET_DFU_ERROR_INVALID_PATCH,
+    VOYAGER_TARGET_DFU_ERROR_NO_CHECKPOINT,
 } voyager_target_dfu_error_E;
 
 typedef enum {
@@ -41,8 +48,37 @@ typedef enum {
     VOYAGER_HOST_DFU_ERROR_INTERNAL_ERROR,
     VOYAGER_HOST_DFU_ERROR_CRC_MISMATCH,
     VOYAGER_HOST_DFU_ERROR_UNKNOWN_ERROR_CODE,
+    VOYAGER_HOST_DFU_ERROR_UNSUPPORTED_FEATURE,
+    VOYAGER_HOST_DFU_ERROR_INVALID_COMPRESSED_DATA,
+    VOYAGER_HOST_DFU_ERROR_BASE_IMAGE_MISMATCH,
+    VOYAGER_HOST_DFU_ERROR_INVALID_PATCH,
+    VOYAGER_HOST_DFU_ERROR_NO_CHECKPOINT,
+    VOYAGER_HOST_DFU_ERROR_TIMEOUT,
+    VOYAGER_HOST_DFU_ERROR_TRANSPORT_ERROR,
+    VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR,
 } voyager_host_dfu_error_E;
 
+/// @brief START flag announcing that DATA payloads carry a stream compressed with voyager_host_lz_compress
+#define VOYAGER_HOST_START_FLAG_COMPRESSED 0x01U
+/// @brief START flag announcing that DATA payloads carry a patch generated with voyager_host_generate_patch
+#define VOYAGER_HOST_START_FLAG_DELTA 0x02U
+/// @brief START flag asking the target to resume the DFU from its stored checkpoint
+#define VOYAGER_HOST_START_FLAG_RESUME 0x04U
+
+/// @brief Bytes in front of the payload of a DATA packet, its message ID and sequence number
+#define VOYAGER_HOST_DATA_PACKET_OVERHEAD 2U
+/// @brief Largest application a START request can describe in its 24 bit size field
+#define VOYAGER_HOST_MAX_APP_SIZE 0xFFFFFFU
+
+/**
+ * @brief Sequence number state of one DFU. Each DFU a host runs has its own, so packets can be generated
+ * ahead of time or for several targets at once without any shared state
+ */
+typedef struct {
+    /// @brief The sequence number given to the next DATA packet
+    uint8_t next_sequence_number;
+} voyager_host_generator_context_t;
+
 /**
  * @brief voyager_host_message_generator_generate_start_request Generates a
  * start request packet
@@ -53,8 +89,8 @@ typedef enum {
  * @return true if successful, otherwise false
  * @note The buffer must be at least 8 bytes
  */
-bool voyager_host_message_generator_generate_start_request(uint8_t *const buffer, const size_t buffer_size,
-                                                           const uint32_t app_size, const uint32_t app_crc) {
+static inline bool voyager_host_message_generator_generate_start_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                         const uint32_t app_size, const uint32_t app_crc) {
     static const uint8_t message_size_bytes = 8U;
 
     bool ret = false;
@@ -79,15 +115,207 @@ bool voyager_host_message_generator_generate_start_request(uint8_t *const buffer
 }
 
 /**
- * @brief voyager_host_message_generator_generate_data_packet Generates a data
+ * @brief voyager_host_message_generator_generate_windowed_start_request Generates a
+ * start request packet that asks the target for a sliding window
+ * @param buffer The buffer to write the packet to
+ * @param buffer_size The size of the buffer
+ * @param app_size The size of the application
+ * @param app_crc The CRC of the application
+ * @param window_size The number of unacknowledged DATA packets the host would like to have in flight
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 9 bytes. The window granted by the target is
+ * returned in the START ACK, see voyager_host_get_granted_window_size
+ */
+static inline bool voyager_host_message_generator_generate_windowed_start_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                                  const uint32_t app_size, const uint32_t app_crc,
+                                                                                  const uint8_t window_size) {
+    static const uint8_t message_size_bytes = 9U;
+
+    bool ret = false;
+    if ((buffer != NULL) && (buffer_size >= message_size_bytes)) {
+        ret = voyager_host_message_generator_generate_start_request(buffer, buffer_size, app_size, app_crc);
+
+        // byte 8 is the requested window size
+        buffer[8] = window_size;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_batched_start_request Generates a
+ * start request packet that asks the target for a sliding window and cumulative ACKs
+ * @param buffer The buffer to write the packet to
+ * @param buffer_size The size of the buffer
+ * @param app_size The size of the application
+ * @param app_crc The CRC of the application
+ * @param window_size The number of unacknowledged DATA packets the host would like to have in flight
+ * @param ack_interval The number of DATA packets the host would like each ACK to cover
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 10 bytes. The target grants an interval no larger than the
+ * window, see voyager_host_get_granted_ack_interval
+ */
+static inline bool voyager_host_message_generator_generate_batched_start_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                                 const uint32_t app_size, const uint32_t app_crc,
+                                                                                 const uint8_t window_size,
+                                                                                 const uint8_t ack_interval) {
+    static const uint8_t message_size_bytes = 10U;
+
+    bool ret = false;
+    if ((buffer != NULL) && (buffer_size >= message_size_bytes)) {
+        ret = voyager_host_message_generator_generate_windowed_start_request(buffer, buffer_size, app_size, app_crc,
+                                                                             window_size);
+
+        // byte 9 is the requested ACK interval
+        buffer[9] = ack_interval;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_compressed_start_request Generates a
+ * start request packet announcing that the DATA payloads carry a compressed image
+ * @param buffer The buffer to write the packet to
+ * @param buffer_size The size of the buffer
+ * @param app_size The size of the application once decompressed
+ * @param app_crc The CRC of the application once decompressed
+ * @param window_size The number of unacknowledged DATA packets the host would like to have in flight
+ * @param ack_interval The number of DATA packets the host would like each ACK to cover
+ * @param lz_window_bits The window_bits the image was compressed with by voyager_host_lz_compress
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 12 bytes. A target that cannot decompress with a window
+ * this large NACKs the start request with VOYAGER_TARGET_DFU_ERROR_UNSUPPORTED_FEATURE
+ */
+static inline bool voyager_host_message_generator_generate_compressed_start_request(uint8_t *const buffer,
+                                                                                    const size_t buffer_size,
+                                                                                    const uint32_t app_size,
+                                                                                    const uint32_t app_crc,
+                                                                                    const uint8_t window_size,
+                                                                                    const uint8_t ack_interval,
+                                                                                    const uint8_t lz_window_bits) {
+    static const uint8_t message_size_bytes = 12U;
+
+    bool ret = false;
+    if ((buffer != NULL) && (buffer_size >= message_size_bytes)) {
+        ret = voyager_host_message_generator_generate_batched_start_request(buffer, buffer_size, app_size, app_crc,
+                                                                            window_size, ack_interval);
+
+        // byte 10 holds the transfer flags and byte 11 the compression window
+        buffer[10] = VOYAGER_HOST_START_FLAG_COMPRESSED;
+        buffer[11] = lz_window_bits;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_delta_start_request Generates a
+ * start request packet announcing that the DATA payloads carry a patch against the current application
+ * @param buffer The buffer to write the packet to
+ * @param buffer_size The size of the buffer
+ * @param app_size The size of the application the patch reconstructs
+ * @param app_crc The CRC of the application the patch reconstructs
+ * @param window_size The number of unacknowledged DATA packets the host would like to have in flight
+ * @param ack_interval The number of DATA packets the host would like each ACK to cover
+ * @param base_crc The CRC of the application the patch was generated against
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 16 bytes. A target running a different application NACKs the
+ * start request with VOYAGER_TARGET_DFU_ERROR_BASE_IMAGE_MISMATCH, and one without a staging area
+ * with VOYAGER_TARGET_DFU_ERROR_UNSUPPORTED_FEATURE
+ */
+static inline bool voyager_host_message_generator_generate_delta_start_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                               const uint32_t app_size, const uint32_t app_crc,
+                                                                               const uint8_t window_size,
+                                                                               const uint8_t ack_interval,
+                                                                               const uint32_t base_crc) {
+    static const uint8_t message_size_bytes = 16U;
+
+    bool ret = false;
+    if ((buffer != NULL) && (buffer_size >= message_size_bytes)) {
+        ret = voyager_host_message_generator_generate_batched_start_request(buffer, buffer_size, app_size, app_crc,
+                                                                            window_size, ack_interval);
+
+        // byte 10 holds the transfer flags, byte 11 is unused and bytes 12 to 15 hold the base CRC
+        buffer[10] = VOYAGER_HOST_START_FLAG_DELTA;
+        buffer[11] = 0U;
+        buffer[12] = (uint8_t)(base_crc >> 24);
+        buffer[13] = (uint8_t)(base_crc >> 16);
+        buffer[14] = (uint8_t)(base_crc >> 8);
+        buffer[15] = (uint8_t)(base_crc & 0xFF);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_resume_start_request Generates a
+ * start request packet that resumes an interrupted DFU from the checkpoint stored on the target
+ * @param buffer The buffer to write the packet to
+ * @param buffer_size The size of the buffer
+ * @param app_size The size of the application
+ * @param app_crc The CRC of the application
+ * @param window_size The number of unacknowledged DATA packets the host would like to have in flight
+ * @param ack_interval The number of DATA packets the host would like each ACK to cover
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 12 bytes. Once ACKed, the host sends the application from the
+ * offset returned by voyager_host_get_checkpoint_offset, starting again at sequence number 0. A target
+ * without a checkpoint of the application NACKs the start request with VOYAGER_TARGET_DFU_ERROR_NO_CHECKPOINT
+ */
+static inline bool voyager_host_message_generator_generate_resume_start_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                                const uint32_t app_size, const uint32_t app_crc,
+                                                                                const uint8_t window_size,
+                                                                                const uint8_t ack_interval) {
+    static const uint8_t message_size_bytes = 12U;
+
+    bool ret = false;
+    if ((buffer != NULL) && (buffer_size >= message_size_bytes)) {
+        ret = voyager_host_message_generator_generate_batched_start_request(buffer, buffer_size, app_size, app_crc,
+                                                                            window_size, ack_interval);
+
+        // byte 10 holds the transfer flags, byte 11 is unused
+        buffer[10] = VOYAGER_HOST_START_FLAG_RESUME;
+        buffer[11] = 0U;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_query_request Generates a
+ * query packet asking how much of a DFU the target can resume
  * @param buffer The buffer to write the packet to
  * @param buffer_size The size of the buffer
- * @param sequence_number The sequence number of the packet to ACK
+ * @param app_size The size of the application
+ * @param app_crc The CRC of the application
+ * @return true if successful, otherwise false
+ * @note The buffer must be at least 8 bytes. The target may be queried before it is asked to enter DFU mode
+ */
+static inline bool voyager_host_message_generator_generate_query_request(uint8_t *const buffer, const size_t buffer_size,
+                                                                         const uint32_t app_size, const uint32_t app_crc) {
+    // Laid out like a START message that does not negotiate any options
+    bool ret = voyager_host_message_generator_generate_start_request(buffer, buffer_size, app_size, app_crc);
+    if (ret) {
+        buffer[0] = VOYAGER_HOST_MESSAGE_ID_QUERY;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_data_packet_with_sequence Generates a data
+ * packet with an explicit sequence number, e.g. to go back and resend a window
+ * @param buffer The buffer to write the packet to
+ * @param len The size of the buffer
+ * @param payload The payload of the packet
+ * @param payload_len The size of the payload
+ * @param sequence_number The sequence number of the packet
  * @return the number of bytes written to the buffer
- *
  */
-size_t voyager_host_message_generator_generate_data_packet(uint8_t *const buffer, size_t len, const uint8_t *const payload,
-                                                           size_t payload_len, bool reset_sequence_number) {
+static inline size_t voyager_host_message_generator_generate_data_packet_with_sequence(uint8_t *const buffer, size_t len,
+                                                                                       const uint8_t *const payload,
+                                                                                       size_t payload_len,
+                                                                                       const uint8_t sequence_number) {
     size_t ret = 0;
     if ((buffer != NULL) && (len >= payload_len + 2U)) {
         // clear the buffer
@@ -95,12 +323,7 @@ size_t voyager_host_message_generator_generate_data_packet(uint8_t *const buffer
 
         buffer[0] = VOYAGER_HOST_MESSAGE_ID_DATA;
         // first byte is the sequence number
-        static uint8_t sequence_number = 0;
-        if (reset_sequence_number) {
-            sequence_number = 0;
-        }
         buffer[1] = sequence_number;
-        sequence_number = (sequence_number + 1) % 256;
         if (payload != NULL) {
             memcpy(&buffer[2], payload, payload_len);
         }
@@ -111,12 +334,399 @@ size_t voyager_host_message_generator_generate_data_packet(uint8_t *const buffer
 }
 
 /**
- * @brief voyager_host_calculate_crc Calculates the CRC of a buffer
- * @param buffer The buffer to calculate the CRC of
+ * @brief voyager_host_generator_context_init Starts the sequence numbers of a DFU from 0
+ * @param context The context of the DFU, to be initialised before its first DATA packet is generated
+ */
+static inline void voyager_host_generator_context_init(voyager_host_generator_context_t *const context) {
+    if (context != NULL) {
+        context->next_sequence_number = 0U;
+    }
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_data_packet Generates the next data packet of a DFU
+ * @param context The context of the DFU, whose sequence number is given to the packet and advanced
+ * @param buffer The buffer to write the packet to
+ * @param len The size of the buffer
+ * @param payload The payload of the packet
+ * @param payload_len The size of the payload
+ * @return the number of bytes written to the buffer, 0 if the context is NULL or the buffer too small
+ */
+static inline size_t voyager_host_message_generator_generate_data_packet(voyager_host_generator_context_t *const context,
+                                                                         uint8_t *const buffer, size_t len,
+                                                                         const uint8_t *const payload, size_t payload_len) {
+    size_t ret = 0U;
+    if (context != NULL) {
+        ret = voyager_host_message_generator_generate_data_packet_with_sequence(buffer, len, payload, payload_len,
+                                                                               context->next_sequence_number);
+        if (ret > 0U) {
+            context->next_sequence_number = (uint8_t)((context->next_sequence_number + 1U) % 256U);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_data_packets Generates the next data packets of a DFU
+ * back to back, e.g. to build a whole window ahead of sending it
+ * @param context The context of the DFU, whose sequence numbers are given to the packets and advanced
+ * @param buffer The buffer to write the packets to
+ * @param len The size of the buffer
+ * @param image The image bytes to send, starting with the payload of the first packet
+ * @param image_len The number of image bytes left to send
+ * @param max_payload The number of image bytes carried by each packet
+ * @param packet_count The number of packets to generate, fewer if the image runs out first
+ * @return the number of bytes written to the buffer, 0 if nothing could be generated or the buffer is
+ * too small for every packet
+ * @note Every packet is max_payload + 2 bytes long except the last one of the image, so packet i starts
+ * at i * (max_payload + 2) and carries the image from i * max_payload
+ */
+static inline size_t voyager_host_message_generator_generate_data_packets(voyager_host_generator_context_t *const context,
+                                                                          uint8_t *const buffer, size_t len,
+                                                                          const uint8_t *const image, size_t image_len,
+                                                                          size_t max_payload, size_t packet_count) {
+    size_t ret = 0U;
+    do {
+        if ((context == NULL) || (buffer == NULL) || (image == NULL) || (max_payload == 0U)) {
+            break;
+        }
+
+        // Check the whole batch fits up front, so a failed call leaves the context untouched
+        const size_t image_packets = (image_len + max_payload - 1U) / max_payload;
+        if (packet_count > image_packets) {
+            packet_count = image_packets;
+        }
+        const size_t payload_total = (packet_count == image_packets) ? image_len : (packet_count * max_payload);
+        if ((packet_count == 0U) || (len < payload_total + (packet_count * VOYAGER_HOST_DATA_PACKET_OVERHEAD))) {
+            break;
+        }
+
+        for (size_t i = 0U; i < packet_count; i++) {
+            const size_t image_offset = i * max_payload;
+            const size_t payload_len = ((image_len - image_offset) < max_payload) ? (image_len - image_offset) : max_payload;
+            ret += voyager_host_message_generator_generate_data_packet(context, &buffer[ret],
+                                                                       payload_len + VOYAGER_HOST_DATA_PACKET_OVERHEAD,
+                                                                       &image[image_offset], payload_len);
+        }
+    } while (false);
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_fill_packet_with_sequence Generates a fill
+ * packet, which stands in for a data packet whose payload is a run of a single byte value
+ * such as padding
+ * @param buffer The buffer to write the packet to
+ * @param len The size of the buffer
+ * @param fill_length The number of bytes the run is long, at most 24 bits
+ * @param fill_value The value of every byte in the run
+ * @param sequence_number The sequence number of the packet
+ * @return the number of bytes written to the buffer
+ * @note The buffer must be at least 6 bytes
+ */
+static inline size_t voyager_host_message_generator_generate_fill_packet_with_sequence(uint8_t *const buffer, size_t len,
+                                                                                       const uint32_t fill_length,
+                                                                                       const uint8_t fill_value,
+                                                                                       const uint8_t sequence_number) {
+    static const size_t message_size_bytes = 6U;
+
+    size_t ret = 0;
+    if ((buffer != NULL) && (len >= message_size_bytes) && (fill_length <= 0xffffffU)) {
+        buffer[0] = VOYAGER_HOST_MESSAGE_ID_FILL;
+        buffer[1] = sequence_number;
+        // pack the fill length, big endian
+        buffer[2] = (fill_length >> 16) & 0xff;
+        buffer[3] = (fill_length >> 8) & 0xff;
+        buffer[4] = fill_length & 0xff;
+        buffer[5] = fill_value;
+        ret = message_size_bytes;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_message_generator_get_fill_run_length Measures the run of identical bytes at the start of a buffer
+ * @param data The buffer to measure
+ * @param len The size of the buffer
+ * @return the number of bytes equal to the first one, at most the longest fill a fill packet can describe
+ */
+static inline size_t voyager_host_message_generator_get_fill_run_length(const uint8_t *const data, size_t len) {
+    size_t run_length = 0;
+    while ((run_length < len) && (run_length < 0xffffffU) && (data[run_length] == data[0])) {
+        run_length++;
+    }
+
+    return run_length;
+}
+
+/**
+ * @brief voyager_host_message_generator_generate_image_packet Generates the next packet of an
+ * image, collapsing runs of a single byte value into fill packets
+ * @param buffer The buffer to write the packet to
+ * @param len The size of the buffer, which limits the payload of data packets
+ * @param image The part of the image that has not been sent yet
+ * @param remaining The number of bytes of the image that have not been sent yet
+ * @param min_fill_run The shortest run sent as a fill packet, 0 to only send data packets
+ * @param sequence_number The sequence number of the packet
+ * @param consumed Set to the number of bytes of the image the packet covers
+ * @return the number of bytes written to the buffer
+ */
+static inline size_t voyager_host_message_generator_generate_image_packet(uint8_t *const buffer, size_t len,
+                                                                          const uint8_t *const image, size_t remaining,
+                                                                          size_t min_fill_run, const uint8_t sequence_number,
+                                                                          size_t *const consumed) {
+    size_t ret = 0;
+    *consumed = 0;
+    if ((buffer != NULL) && (image != NULL) && (remaining > 0U) && (len > 2U)) {
+        const size_t run_length = voyager_host_message_generator_get_fill_run_length(image, remaining);
+        if ((min_fill_run > 0U) && (run_length >= min_fill_run)) {
+            ret = voyager_host_message_generator_generate_fill_packet_with_sequence(buffer, len, run_length, image[0],
+                                                                                   sequence_number);
+            *consumed = (ret > 0U) ? run_length : 0U;
+        } else {
+            // Send data up to the next run that is worth a fill packet
+            size_t payload_len = 0;
+            while ((payload_len < (len - 2U)) && (payload_len < remaining)) {
+                if ((min_fill_run > 0U) && (voyager_host_message_generator_get_fill_run_length(
+                                                &image[payload_len], remaining - payload_len) >= min_fill_run)) {
+                    break;
+                }
+                payload_len++;
+            }
+
+            ret = voyager_host_message_generator_generate_data_packet_with_sequence(buffer, len, image, payload_len,
+                                                                                   sequence_number);
+            *consumed = payload_len;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_lz_compress Compresses an image into the stream a target decompresses
+ * DATA payloads with after a compressed start request
+ * @param input The image to compress
+ * @param input_size The size of the image
+ * @param output The buffer to write the stream to
+ * @param output_size The size of the buffer, input_size + input_size / 8 + 1 is always enough
+ * @param window_bits log2 of the distance matches may reach back, between 4 and 12. The
+ * target must be built with a VOYAGER_BOOTLOADER_LZ_WINDOW_BITS at least this large
+ * @return the size of the stream, or 0 if it does not fit in the buffer
+ * @note The stream is a sequence of groups of eight items, each group preceded by a flags
+ * byte read LSB first. A set flag is a literal byte, a clear flag a big endian 16 bit token
+ * holding the match offset - 1 in its upper 12 bits and the match length - 3 in its lower 4.
+ * The stream may be split between DATA payloads at any byte
+ */
+static inline size_t voyager_host_lz_compress(const uint8_t *const input, const size_t input_size, uint8_t *const output,
+                                              const size_t output_size, const uint8_t window_bits) {
+    static const size_t MIN_MATCH = 3U;
+    static const size_t MAX_MATCH = 18U;
+
+    size_t out = 0U;
+    size_t flags_index = 0U;
+    uint8_t item = 8U;  // items in the current group, 8 to start a new one
+    size_t in = 0U;
+    bool fits = (input != NULL) && (output != NULL) && (window_bits >= 4U) && (window_bits <= 12U);
+    const size_t window_size = (size_t)1U << window_bits;
+    while (fits && (in < input_size)) {
+        if (item == 8U) {
+            if (out >= output_size) {
+                fits = false;
+                break;
+            }
+            flags_index = out;
+            output[out++] = 0U;
+            item = 0U;
+        }
+
+        // Greedily take the longest match in the window, the nearest one on a tie
+        size_t best_length = 0U;
+        size_t best_offset = 0U;
+        const size_t max_length = ((input_size - in) < MAX_MATCH) ? (input_size - in) : MAX_MATCH;
+        const size_t max_offset = (in < window_size) ? in : window_size;
+        for (size_t offset = 1U; (offset <= max_offset) && (best_length < max_length); offset++) {
+            size_t length = 0U;
+            while ((length < max_length) && (input[in + length] == input[in + length - offset])) {
+                length++;
+            }
+            if (length > best_length) {
+                best_length = length;
+                best_offset = offset;
+            }
+        }
+
+        if (best_length >= MIN_MATCH) {
+            if ((out + 2U) > output_size) {
+                fits = false;
+                break;
+            }
+            const uint16_t token = (uint16_t)(((best_offset - 1U) << 4) | (best_length - MIN_MATCH));
+            output[out++] = (uint8_t)(token >> 8);
+            output[out++] = (uint8_t)(token & 0xFF);
+            in += best_length;
+        } else {
+            if (out >= output_size) {
+                fits = false;
+                break;
+            }
+            output[flags_index] |= (uint8_t)(1U << item);
+            output[out++] = input[in++];
+        }
+        item++;
+    }
+
+    return fits ? out : 0U;
+}
+
+/// @brief Number of earlier occurrences of a window voyager_host_generate_patch tries to extend into a copy
+#define VOYAGER_HOST_PATCH_MAX_CANDIDATES 32U
+
+// Hashes the 8 byte window voyager_host_generate_patch indexes the current application by
+static inline size_t voyager_host_patch_hash(const uint8_t *const window) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0U; i < 8U; i++) {
+        hash = (hash ^ window[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * @brief voyager_host_generate_patch Generates the patch a target applies to its current application
+ * after a delta start request
+ * @param old_image The application currently on the target
+ * @param old_size The size of the current application
+ * @param new_image The application to update to
+ * @param new_size The size of the new application
+ * @param output The buffer to write the patch to
+ * @param output_size The size of the buffer, new_size + 4 * (new_size / 0xFFFFFF + 1) is always enough
+ * @return the size of the patch, or 0 if it does not fit in the buffer
+ * @note The patch is a sequence of ops. COPY (0x01) is followed by a 3 byte source offset into the
+ * current application and a 3 byte length, INSERT (0x02) by a 3 byte length and that many bytes of
+ * the new application. All fields are big endian. The patch may be split between DATA payloads at any byte
+ */
+static inline size_t voyager_host_generate_patch(const uint8_t *const old_image, const size_t old_size,
+                                                 const uint8_t *const new_image, const size_t new_size, uint8_t *const output,
+                                                 const size_t output_size) {
+    static const size_t MIN_COPY = 8U;
+    static const size_t MAX_LENGTH = 0xFFFFFFU;
+    static const size_t HASH_SIZE = 4096U;
+
+    size_t out = 0U;
+    bool fits = (old_image != NULL) && (new_image != NULL) && (output != NULL) && (old_size <= MAX_LENGTH) &&
+                (new_size <= MAX_LENGTH);
+
+    // Chain every MIN_COPY byte window of the current application by its hash, the most recent first
+    size_t *const head = (size_t *)malloc(HASH_SIZE * sizeof(size_t));
+    size_t *const next = (size_t *)malloc((old_size + 1U) * sizeof(size_t));
+    fits = fits && (head != NULL) && (next != NULL);
+    if (fits) {
+        for (size_t i = 0U; i < HASH_SIZE; i++) {
+            head[i] = SIZE_MAX;
+        }
+        for (size_t i = 0U; (i + MIN_COPY) <= old_size; i++) {
+            const size_t hash = voyager_host_patch_hash(&old_image[i]) % HASH_SIZE;
+            next[i] = head[hash];
+            head[hash] = i;
+        }
+    }
+
+    size_t in = 0U;
+    size_t insert_start = 0U;
+    size_t previous_copy_end = 0U;
+    while (fits && (in <= new_size)) {
+        size_t best_length = 0U;
+        size_t best_offset = 0U;
+        const size_t max_length = ((new_size - in) < MAX_LENGTH) ? (new_size - in) : MAX_LENGTH;
+
+        if ((in < new_size) && (max_length >= MIN_COPY)) {
+            // Code that did not change usually sits at the same or a shifted offset, so try continuing the
+            // previous copy and the same offset before the hash chain
+            size_t candidates[2U + VOYAGER_HOST_PATCH_MAX_CANDIDATES];
+            size_t candidate_count = 0U;
+            candidates[candidate_count++] = previous_copy_end;
+            candidates[candidate_count++] = in;
+            size_t chained = head[voyager_host_patch_hash(&new_image[in]) % HASH_SIZE];
+            for (size_t i = 0U; (i < VOYAGER_HOST_PATCH_MAX_CANDIDATES) && (chained != SIZE_MAX); i++) {
+                candidates[candidate_count++] = chained;
+                chained = next[chained];
+            }
+
+            for (size_t i = 0U; i < candidate_count; i++) {
+                const size_t offset = candidates[i];
+                if (offset >= old_size) {
+                    continue;
+                }
+                const size_t limit = ((old_size - offset) < max_length) ? (old_size - offset) : max_length;
+                size_t length = 0U;
+                while ((length < limit) && (old_image[offset + length] == new_image[in + length])) {
+                    length++;
+                }
+                if (length > best_length) {
+                    best_length = length;
+                    best_offset = offset;
+                }
+            }
+        }
+
+        const bool copy = best_length >= MIN_COPY;
+        const size_t insert_length = in - insert_start;
+        if ((insert_length > 0U) && (copy || (in == new_size) || (insert_length == MAX_LENGTH))) {
+            // Flush the bytes no copy was found for
+            if ((out + 4U + insert_length) > output_size) {
+                fits = false;
+                break;
+            }
+            output[out++] = 0x02U;
+            output[out++] = (uint8_t)(insert_length >> 16);
+            output[out++] = (uint8_t)(insert_length >> 8);
+            output[out++] = (uint8_t)(insert_length & 0xFF);
+            memcpy(&output[out], &new_image[insert_start], insert_length);
+            out += insert_length;
+            insert_start = in;
+        }
+
+        if (in == new_size) {
+            break;
+        }
+
+        if (copy) {
+            if ((out + 7U) > output_size) {
+                fits = false;
+                break;
+            }
+            output[out++] = 0x01U;
+            output[out++] = (uint8_t)(best_offset >> 16);
+            output[out++] = (uint8_t)(best_offset >> 8);
+            output[out++] = (uint8_t)(best_offset & 0xFF);
+            output[out++] = (uint8_t)(best_length >> 16);
+            output[out++] = (uint8_t)(best_length >> 8);
+            output[out++] = (uint8_t)(best_length & 0xFF);
+            in += best_length;
+            insert_start = in;
+            previous_copy_end = best_offset + best_length;
+        } else {
+            in++;
+            previous_copy_end++;
+        }
+    }
+
+    free(head);
+    free(next);
+    return fits ? out : 0U;
+}
+
+/**
+ * @brief voyager_host_accumulate_crc Further calculates a CRC over a buffer
+ * @param crc The CRC calculated so far, 0xffffffff to start a new CRC
+ * @param buffer The buffer to add to the CRC
  * @param app_size The size of the buffer
- * @return The CRC of the buffer
+ * @return The CRC including the buffer
  */
-uint32_t voyager_host_calculate_crc(const void *buffer, const size_t app_size) {
+static inline uint32_t voyager_host_accumulate_crc(const uint32_t crc, const void *buffer, const size_t app_size) {
     size_t size = app_size;
 
     // CRC table is the same CRC table used by GNU libiberty
@@ -150,7 +760,7 @@ uint32_t voyager_host_calculate_crc(const void *buffer, const size_t app_size) {
 
     const uint8_t *buf = (uint8_t *)buffer;
 
-    uint32_t calculated_crc = 0xffffffff;
+    uint32_t calculated_crc = crc;
     while (size--) {
         calculated_crc = (calculated_crc << 8) ^ crc32_table[((calculated_crc >> 24) ^ *buf) & 255];
         buf++;
@@ -159,8 +769,23 @@ uint32_t voyager_host_calculate_crc(const void *buffer, const size_t app_size) {
     return calculated_crc;
 }
 
-voyager_host_dfu_error_E voyager_host_compare_ack_message(const void *const msg, size_t len, const void *const previous_message,
-                                                          size_t previous_message_len) {
+/**
+ * @brief voyager_host_calculate_crc Calculates the CRC of a buffer
+ * @param buffer The buffer to calculate the CRC of
+ * @param app_size The size of the buffer
+ * @return The CRC of the buffer
+ */
+static inline uint32_t voyager_host_calculate_crc(const void *buffer, const size_t app_size) {
+    return voyager_host_accumulate_crc(0xffffffff, buffer, app_size);
+}
+
+/**
+ * @brief voyager_host_check_ack_message Checks the size, message ID and error code of an ACK message
+ * @param msg The ACK message received from the target
+ * @param len The size of the ACK message
+ * @return VOYAGER_HOST_DFU_ERROR_NONE if the target accepted the message being acknowledged, otherwise an error code
+ */
+static inline voyager_host_dfu_error_E voyager_host_check_ack_message(const void *const msg, size_t len) {
     static const size_t VOYAGER_ACK_MESSAGE_SIZE = 8U;
     voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
     do {
@@ -201,20 +826,51 @@ voyager_host_dfu_error_E voyager_host_compare_ack_message(const void *const msg,
             case VOYAGER_TARGET_DFU_ERROR_INTERNAL_ERROR:
                 ret = VOYAGER_HOST_DFU_ERROR_INTERNAL_ERROR;
                 break;
+            case VOYAGER_TARGET_DFU_ERROR_UNSUPPORTED_FEATURE:
+                ret = VOYAGER_HOST_DFU_ERROR_UNSUPPORTED_FEATURE;
+                break;
+            case VOYAGER_TARGET_DFU_ERROR_INVALID_COMPRESSED_DATA:
+                ret = VOYAGER_HOST_DFU_ERROR_INVALID_COMPRESSED_DATA;
+                break;
+            case VOYAGER_TARGET_DFU_ERROR_BASE_IMAGE_MISMATCH:
+                ret = VOYAGER_HOST_DFU_ERROR_BASE_IMAGE_MISMATCH;
+                break;
+            case VOYAGER_TARGET_DFU_ERROR_INVALID_PATCH:
+                ret = VOYAGER_HOST_DFU_ERROR_INVALID_PATCH;
+                break;
+            case VOYAGER_TARGET_DFU_ERROR_NO_CHECKPOINT:
+                ret = VOYAGER_HOST_DFU_ERROR_NO_CHECKPOINT;
+                break;
             default:
                 ret = VOYAGER_HOST_DFU_ERROR_UNKNOWN_ERROR_CODE;
                 break;
         }
+    } while (false);
+
+    return ret;
+}
 
+/**
+ * @brief voyager_host_compare_ack_crc Checks an ACK message against the CRC the target should report
+ * @param msg The ACK message received from the target
+ * @param len The size of the ACK message
+ * @param expected_crc The CRC of the acknowledged message without its message ID, e.g. from a packet stream file
+ * @return VOYAGER_HOST_DFU_ERROR_NONE if the target accepted the message, otherwise an error code
+ */
+static inline voyager_host_dfu_error_E voyager_host_compare_ack_crc(const void *const msg, size_t len,
+                                                                    const uint32_t expected_crc) {
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
+    do {
+        ret = voyager_host_check_ack_message(msg, len);
         if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
             break;
         }
 
         // If the voyager error is none, then we need to check the CRC
-        const uint8_t *const previous_message_buffer = (uint8_t *)previous_message;
-        const uint32_t crc = voyager_host_calculate_crc(previous_message_buffer + 1, previous_message_len - 1);
-        const uint32_t crc_from_target = (buffer[2] << 24) | (buffer[3] << 16) | (buffer[4] << 8) | buffer[5];
-        if (crc != crc_from_target) {
+        const uint8_t *const buffer = (uint8_t *)msg;
+        const uint32_t crc_from_target =
+            ((uint32_t)buffer[2] << 24) | ((uint32_t)buffer[3] << 16) | ((uint32_t)buffer[4] << 8) | (uint32_t)buffer[5];
+        if (expected_crc != crc_from_target) {
             ret = VOYAGER_HOST_DFU_ERROR_CRC_MISMATCH;
             break;
         }
@@ -224,4 +880,96 @@ voyager_host_dfu_error_E voyager_host_compare_ack_message(const void *const msg,
     return ret;
 }
 
+static inline voyager_host_dfu_error_E voyager_host_compare_ack_message(const void *const msg, size_t len,
+                                                                        const void *const previous_message,
+                                                                        size_t previous_message_len) {
+    const uint8_t *const previous_message_buffer = (uint8_t *)previous_message;
+    return voyager_host_compare_ack_crc(msg, len,
+                                        voyager_host_calculate_crc(previous_message_buffer + 1, previous_message_len - 1));
+}
+
+/**
+ * @brief voyager_host_get_granted_window_size Gets the sliding window granted by the target
+ * @param msg The START ACK message received from the target
+ * @param len The size of the START ACK message
+ * @return The number of DATA packets that may be in flight, 1 if the target only supports stop-and-wait
+ */
+static inline uint8_t voyager_host_get_granted_window_size(const void *const msg, size_t len) {
+    static const size_t VOYAGER_ACK_WINDOW_INDEX = 6U;
+    uint8_t ret = 1U;
+    const uint8_t *const buffer = (const uint8_t *)msg;
+    if ((buffer != NULL) && (len > VOYAGER_ACK_WINDOW_INDEX) && (buffer[VOYAGER_ACK_WINDOW_INDEX] > 0U)) {
+        ret = buffer[VOYAGER_ACK_WINDOW_INDEX];
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_get_resume_sequence_number Gets the sequence number the host should resend from
+ * @param msg An out of sequence NACK message received from the target while a sliding window is in use
+ * @return The sequence number of the first DATA packet the target did not accept
+ */
+static inline uint8_t voyager_host_get_resume_sequence_number(const void *const msg) { return ((const uint8_t *)msg)[2]; }
+
+/**
+ * @brief voyager_host_get_checkpoint_offset Gets the offset a DFU can be resumed from
+ * @param msg The ACK of a query message
+ * @return The number of application bytes the target already holds, 0 if the DFU has to start over
+ */
+static inline uint32_t voyager_host_get_checkpoint_offset(const void *const msg) {
+    const uint8_t *const buffer = (const uint8_t *)msg;
+    return ((uint32_t)buffer[2] << 24) | ((uint32_t)buffer[3] << 16) | ((uint32_t)buffer[4] << 8) | (uint32_t)buffer[5];
+}
+
+/**
+ * @brief voyager_host_get_granted_ack_interval Gets the number of DATA packets covered by each ACK
+ * @param msg The START ACK message received from the target
+ * @param len The size of the START ACK message
+ * @return The granted ACK interval, 1 if every DATA packet is acknowledged
+ */
+static inline uint8_t voyager_host_get_granted_ack_interval(const void *const msg, size_t len) {
+    static const size_t VOYAGER_ACK_INTERVAL_INDEX = 7U;
+    uint8_t ret = 1U;
+    const uint8_t *const buffer = (const uint8_t *)msg;
+    if ((buffer != NULL) && (len > VOYAGER_ACK_INTERVAL_INDEX) && (buffer[VOYAGER_ACK_INTERVAL_INDEX] > 0U)) {
+        ret = buffer[VOYAGER_ACK_INTERVAL_INDEX];
+    }
+
+    return ret;
+}
+
+/**
+ * @brief voyager_host_compare_batched_ack_message Checks a cumulative ACK against the DATA packets it covers
+ * @param msg The ACK message received from the target
+ * @param len The size of the ACK message
+ * @param batch_crc The CRC of every DATA packet sent since the last cumulative ACK, excluding the message ID
+ * (see voyager_host_accumulate_crc)
+ * @param last_sequence_number The sequence number of the last DATA packet sent
+ * @param batch_count The number of DATA packets sent since the last cumulative ACK
+ * @return VOYAGER_HOST_DFU_ERROR_NONE if the ACK covers exactly those packets, otherwise an error code
+ */
+static inline voyager_host_dfu_error_E voyager_host_compare_batched_ack_message(const void *const msg, size_t len,
+                                                                                const uint32_t batch_crc,
+                                                                                const uint8_t last_sequence_number,
+                                                                                const uint8_t batch_count) {
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
+    do {
+        ret = voyager_host_check_ack_message(msg, len);
+        if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+            break;
+        }
+
+        const uint8_t *const buffer = (uint8_t *)msg;
+        const uint32_t crc_from_target =
+            ((uint32_t)buffer[2] << 24) | ((uint32_t)buffer[3] << 16) | ((uint32_t)buffer[4] << 8) | (uint32_t)buffer[5];
+        if ((crc_from_target != batch_crc) || (buffer[6] != last_sequence_number) || (buffer[7] != batch_count)) {
+            ret = VOYAGER_HOST_DFU_ERROR_CRC_MISMATCH;
+            break;
+        }
+    } while (false);
+
+    return ret;
+}
+
 #endif  // VOYAGER_HOST_MESSAGE_GENERATOR_H
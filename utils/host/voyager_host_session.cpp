@@ -0,0 +1,289 @@
+/**
+ * @file voyager_host_session.cpp
+ * @brief DFU host engine that drives a complete transfer over a pluggable transport
+ */
+
+#include "voyager_host_session.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+// Size of the chunks the image is read in while calculating its CRC
+constexpr size_t CRC_READ_CHUNK_SIZE = 4096U;
+
+}  // namespace
+
+VoyagerHostSession::VoyagerHostSession(VoyagerHostTransport &transport, const VoyagerHostSessionOptions &options)
+    : transport_(transport), options_(options) {}
+
+voyager_host_dfu_error_E VoyagerHostSession::flash_file(const std::string &path) {
+    std::ifstream image(path, std::ios::binary);
+    if (!image) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    return flash(image);
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::flash_buffer(const uint8_t *image, size_t size) {
+    if ((image == nullptr) && (size > 0U)) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    return transfer(size, voyager_host_calculate_crc(image, size), [this, image, size](InFlightPacket &packet) {
+        const size_t payload_size = std::min(options_.max_payload, size - bytes_sent_);
+        packet.storage.resize(payload_size + VOYAGER_HOST_DATA_PACKET_OVERHEAD);
+        packet.size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet.storage.data(), packet.storage.size(), &image[bytes_sent_], payload_size, packet.sequence_number);
+        packet.data = packet.storage.data();
+        packet.payload_size = payload_size;
+        packet.ack_crc = voyager_host_calculate_crc(&packet.data[1], packet.size - 1U);
+        return VOYAGER_HOST_DFU_ERROR_NONE;
+    });
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::flash_image(const VoyagerHostImage &image) {
+    // Packets are sent straight out of the image's table, and never copied, regenerated or CRCed
+    return transfer(image.size(), image.crc(), [&image](InFlightPacket &packet) {
+        const VoyagerHostPacket table_packet = image.packet(packet.index);
+        packet.data = table_packet.data;
+        packet.size = table_packet.size;
+        packet.payload_size = table_packet.payload_size;
+        packet.ack_crc = table_packet.ack_crc;
+        return VOYAGER_HOST_DFU_ERROR_NONE;
+    });
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::flash(std::istream &image) {
+    uint32_t image_crc = 0xffffffff;
+    size_t image_size = 0U;
+    std::array<char, CRC_READ_CHUNK_SIZE> chunk;
+
+    image.clear();
+    image.seekg(0, std::ios::beg);
+    while (image.read(chunk.data(), chunk.size()) || (image.gcount() > 0)) {
+        const size_t read = static_cast<size_t>(image.gcount());
+        image_crc = voyager_host_accumulate_crc(image_crc, chunk.data(), read);
+        image_size += read;
+    }
+    if (image.bad()) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    image.clear();
+    image.seekg(0, std::ios::beg);
+    if (!image) {
+        return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+    }
+
+    return transfer(image_size, image_crc, [this, &image, image_size](InFlightPacket &packet) {
+        const size_t payload_size = std::min(options_.max_payload, image_size - bytes_sent_);
+        payload_.resize(payload_size);
+        image.read(reinterpret_cast<char *>(payload_.data()), static_cast<std::streamsize>(payload_size));
+        if (static_cast<size_t>(image.gcount()) != payload_size) {
+            return VOYAGER_HOST_DFU_ERROR_IMAGE_READ_ERROR;
+        }
+
+        packet.storage.resize(payload_size + VOYAGER_HOST_DATA_PACKET_OVERHEAD);
+        packet.size = voyager_host_message_generator_generate_data_packet_with_sequence(
+            packet.storage.data(), packet.storage.size(), payload_.data(), payload_size, packet.sequence_number);
+        packet.data = packet.storage.data();
+        packet.payload_size = payload_size;
+        packet.ack_crc = voyager_host_calculate_crc(&packet.data[1], packet.size - 1U);
+        return VOYAGER_HOST_DFU_ERROR_NONE;
+    });
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::transfer(size_t image_size, uint32_t image_crc, const PacketSource &next_packet) {
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_NONE;
+    in_flight_.clear();
+    packets_sent_ = 0U;
+    bytes_sent_ = 0U;
+    bytes_acked_ = 0U;
+    retransmissions_ = 0U;
+    granted_window_size_ = 1U;
+
+    do {
+        if ((image_size > VOYAGER_HOST_MAX_APP_SIZE) || (options_.max_payload == 0U)) {
+            ret = VOYAGER_HOST_DFU_ERROR_SIZE_TOO_LARGE;
+            break;
+        }
+
+        ret = start(image_size, image_crc);
+        if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+            break;
+        }
+
+        size_t retries = 0U;
+        bool going_back = false;
+        while (bytes_acked_ < image_size) {
+            // Keep the window full, the target drains it as fast as it can write to flash
+            while (!going_back && (in_flight_.size() < granted_window_size_) && (bytes_sent_ < image_size)) {
+                ret = send_next_packet(next_packet);
+                if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                    break;
+                }
+            }
+            if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                break;
+            }
+
+            const size_t ack_size = transport_.receive(ack_.data(), ack_.size(), options_.timeout);
+            if (ack_size == 0U) {
+                // Either a packet or its ACK was lost, resend everything the target has not acknowledged
+                if (retries >= options_.max_retries) {
+                    ret = VOYAGER_HOST_DFU_ERROR_TIMEOUT;
+                    break;
+                }
+                retries++;
+                going_back = false;
+                ret = resend_in_flight(in_flight_.size());
+                if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                    break;
+                }
+                continue;
+            }
+
+            const voyager_host_dfu_error_E ack_error = voyager_host_check_ack_message(ack_.data(), ack_size);
+            if (ack_error == VOYAGER_HOST_DFU_ERROR_NONE) {
+                ret = acknowledge(ack_size, image_size);
+                if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                    break;
+                }
+                retries = 0U;
+
+                // The packets the target dropped after the gap have been drained from its queue by now
+                if (going_back) {
+                    going_back = false;
+                    ret = resend_in_flight(in_flight_.size());
+                    if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                        break;
+                    }
+                }
+                continue;
+            }
+
+            if ((ack_error != VOYAGER_HOST_DFU_ERROR_OUT_OF_SEQUENCE) || (granted_window_size_ <= 1U)) {
+                ret = ack_error;
+                break;
+            }
+
+            // Go-back-N: the target drops everything from the resume sequence number onwards, including the rest of
+            // the window still in its queue. Only the packet it asked for is resent until that has been drained, so
+            // the queue cannot overflow
+            if (!go_back(voyager_host_get_resume_sequence_number(ack_.data()))) {
+                continue;
+            }
+            if (retries >= options_.max_retries) {
+                ret = VOYAGER_HOST_DFU_ERROR_OUT_OF_SEQUENCE;
+                break;
+            }
+            retries++;
+            going_back = true;
+            ret = resend_in_flight(1U);
+            if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+                break;
+            }
+        }
+    } while (false);
+
+    in_flight_.clear();
+    return ret;
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::start(size_t image_size, uint32_t image_crc) {
+    voyager_host_dfu_error_E ret = VOYAGER_HOST_DFU_ERROR_TIMEOUT;
+    std::array<uint8_t, 9> start_packet{};
+    voyager_host_message_generator_generate_windowed_start_request(start_packet.data(), start_packet.size(),
+                                                                   static_cast<uint32_t>(image_size), image_crc,
+                                                                   std::max<uint8_t>(options_.window_size, 1U));
+
+    for (size_t attempt = 0U; attempt <= options_.max_retries; attempt++) {
+        if (!transport_.send(start_packet.data(), start_packet.size())) {
+            ret = VOYAGER_HOST_DFU_ERROR_TRANSPORT_ERROR;
+            break;
+        }
+
+        const size_t ack_size = transport_.receive(ack_.data(), ack_.size(), options_.timeout);
+        if (ack_size == 0U) {
+            continue;
+        }
+
+        ret = voyager_host_compare_ack_message(ack_.data(), ack_size, start_packet.data(), start_packet.size());
+        if (ret == VOYAGER_HOST_DFU_ERROR_NONE) {
+            granted_window_size_ = voyager_host_get_granted_window_size(ack_.data(), ack_size);
+        }
+        break;
+    }
+
+    return ret;
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::send_next_packet(const PacketSource &next_packet) {
+    in_flight_.push_back(InFlightPacket{packets_sent_, static_cast<uint8_t>(packets_sent_), 0U, nullptr, 0U, 0U, {}});
+    InFlightPacket &packet = in_flight_.back();
+    voyager_host_dfu_error_E ret = next_packet(packet);
+    if ((ret == VOYAGER_HOST_DFU_ERROR_NONE) && !transport_.send(packet.data, packet.size)) {
+        ret = VOYAGER_HOST_DFU_ERROR_TRANSPORT_ERROR;
+    }
+    if (ret != VOYAGER_HOST_DFU_ERROR_NONE) {
+        in_flight_.pop_back();
+        return ret;
+    }
+
+    packets_sent_++;
+    bytes_sent_ += packet.payload_size;
+    return VOYAGER_HOST_DFU_ERROR_NONE;
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::resend_in_flight(size_t count) {
+    for (size_t i = 0U; (i < count) && (i < in_flight_.size()); i++) {
+        const InFlightPacket &packet = in_flight_[i];
+        if (!transport_.send(packet.data, packet.size)) {
+            return VOYAGER_HOST_DFU_ERROR_TRANSPORT_ERROR;
+        }
+        retransmissions_++;
+    }
+
+    return VOYAGER_HOST_DFU_ERROR_NONE;
+}
+
+bool VoyagerHostSession::go_back(uint8_t resume) {
+    // Packets before the resume sequence number were accepted even if their ACKs were lost. A resume sequence
+    // number that is not in flight belongs to a NACK of a repeated packet the target had already accepted
+    const auto resume_packet = std::find_if(in_flight_.begin(), in_flight_.end(),
+                                            [resume](const InFlightPacket &packet) { return packet.sequence_number == resume; });
+    if (resume_packet == in_flight_.end()) {
+        return false;
+    }
+
+    for (auto packet = in_flight_.begin(); packet != resume_packet; ++packet) {
+        bytes_acked_ += packet->payload_size;
+    }
+    in_flight_.erase(in_flight_.begin(), resume_packet);
+    return true;
+}
+
+voyager_host_dfu_error_E VoyagerHostSession::acknowledge(size_t ack_size, size_t image_size) {
+    // The target accepts packets in order, so an ACK also covers every packet sent before the one it matches,
+    // including any whose ACK was lost. The oldest packet in flight is the usual match
+    const auto acknowledged = std::find_if(in_flight_.begin(), in_flight_.end(), [this, ack_size](const InFlightPacket &packet) {
+        return voyager_host_compare_ack_crc(ack_.data(), ack_size, packet.ack_crc) ==
+               VOYAGER_HOST_DFU_ERROR_NONE;
+    });
+    if (acknowledged == in_flight_.end()) {
+        return VOYAGER_HOST_DFU_ERROR_CRC_MISMATCH;
+    }
+
+    for (auto packet = in_flight_.begin(); packet <= acknowledged; ++packet) {
+        bytes_acked_ += packet->payload_size;
+    }
+    in_flight_.erase(in_flight_.begin(), acknowledged + 1);
+    if (options_.progress) {
+        options_.progress(bytes_acked_, image_size);
+    }
+
+    return VOYAGER_HOST_DFU_ERROR_NONE;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file voyager_host_session.hpp
+ * @brief DFU host engine that drives a complete transfer over a pluggable transport
+ *
+ * A VoyagerHostSession streams an image to a target, keeping up to a window of DATA packets in
+ * flight, matching each ACK against the packets still in flight and going back to the packet the
+ * target asks for when one is lost. The link itself is supplied by the user as a VoyagerHostTransport.
+ */
+
+#ifndef VOYAGER_HOST_SESSION_HPP
+#define VOYAGER_HOST_SESSION_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "voyager_host_image.hpp"
+#include "voyager_host_message_generator.h"
+
+/**
+ * @brief Link between the host and a single target, e.g. a serial port or a socket
+ */
+class VoyagerHostTransport {
+   public:
+    virtual ~VoyagerHostTransport() = default;
+
+    /**
+     * @brief Sends one packet to the target
+     * @param data The packet to send
+     * @param len The size of the packet
+     * @return true if the packet was handed to the link, false if the link failed
+     */
+    virtual bool send(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * @brief Waits for one packet from the target
+     * @param buffer The buffer to receive the packet into
+     * @param capacity The size of the buffer
+     * @param timeout How long to wait for the packet
+     * @return the size of the packet received, 0 if none arrived before the timeout
+     */
+    virtual size_t receive(uint8_t *buffer, size_t capacity, std::chrono::milliseconds timeout) = 0;
+};
+
+/**
+ * @brief Options of a VoyagerHostSession
+ */
+struct VoyagerHostSessionOptions {
+    /// @brief Number of DATA packets requested to be in flight at once, the target may grant fewer
+    uint8_t window_size = 1U;
+    /// @brief Number of image bytes carried by each DATA packet, at most the target's receive packet size less 2
+    size_t max_payload = 62U;
+    /// @brief Number of times the window is resent without the target making progress before giving up
+    size_t max_retries = 3U;
+    /// @brief How long to wait for an ACK before resending the packets in flight
+    std::chrono::milliseconds timeout{1000};
+    /// @brief Called with the number of bytes acknowledged so far and the size of the image after every ACK
+    std::function<void(size_t bytes_acked, size_t image_size)> progress;
+};
+
+/**
+ * @brief Runs DFUs of a single target over a transport
+ * @note With a window of 1 the target treats a repeated packet as fatal, so only lost DATA packets are
+ * recovered, not lost ACKs. A window larger than 1 recovers both.
+ */
+class VoyagerHostSession {
+   public:
+    /**
+     * @brief Creates a session
+     * @param transport The link to the target, which must outlive the session
+     * @param options The options of the session
+     */
+    explicit VoyagerHostSession(VoyagerHostTransport &transport, const VoyagerHostSessionOptions &options = {});
+
+    /**
+     * @brief Updates the target with an image stored in a file
+     * @param path The path of the image
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if every byte of the image was acknowledged, otherwise an error code
+     */
+    voyager_host_dfu_error_E flash_file(const std::string &path);
+
+    /**
+     * @brief Updates the target with an image held in memory
+     * @param image The image
+     * @param size The size of the image
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if every byte of the image was acknowledged, otherwise an error code
+     */
+    voyager_host_dfu_error_E flash_buffer(const uint8_t *image, size_t size);
+
+    /**
+     * @brief Updates the target with an image read from a stream
+     * @param image A seekable stream holding the image. It is read once to calculate the CRC and again while
+     * sending, so only the packets in flight are held in memory
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if every byte of the image was acknowledged, otherwise an error code
+     */
+    voyager_host_dfu_error_E flash(std::istream &image);
+
+    /**
+     * @brief Updates the target with an image whose packets were generated ahead of time
+     * @param image The image, which may be sent by several sessions at once. Its packet size is used
+     * in place of max_payload
+     * @return VOYAGER_HOST_DFU_ERROR_NONE if every byte of the image was acknowledged, otherwise an error code
+     */
+    voyager_host_dfu_error_E flash_image(const VoyagerHostImage &image);
+
+    /**
+     * @brief Gets the window granted by the target for the last DFU
+     * @return The number of DATA packets that were allowed in flight
+     */
+    uint8_t granted_window_size() const { return granted_window_size_; }
+
+    /**
+     * @brief Gets the number of DATA packets sent more than once during the last DFU
+     * @return The number of retransmitted packets
+     */
+    size_t retransmissions() const { return retransmissions_; }
+
+   private:
+    /// @brief A DATA packet that has been sent but not acknowledged yet
+    struct InFlightPacket {
+        size_t index;
+        uint8_t sequence_number;
+        size_t payload_size;
+        const uint8_t *data;
+        size_t size;
+        uint32_t ack_crc;
+        // Holds the packet unless it points into a packet table
+        std::vector<uint8_t> storage;
+    };
+
+    // Fills in the next packet of the image, given its index and sequence number
+    using PacketSource = std::function<voyager_host_dfu_error_E(InFlightPacket &packet)>;
+
+    voyager_host_dfu_error_E transfer(size_t image_size, uint32_t image_crc, const PacketSource &next_packet);
+    voyager_host_dfu_error_E start(size_t image_size, uint32_t image_crc);
+    voyager_host_dfu_error_E send_next_packet(const PacketSource &next_packet);
+    voyager_host_dfu_error_E resend_in_flight(size_t count);
+    bool go_back(uint8_t resume);
+    voyager_host_dfu_error_E acknowledge(size_t ack_size, size_t image_size);
+
+    VoyagerHostTransport &transport_;
+    VoyagerHostSessionOptions options_;
+    uint8_t granted_window_size_ = 1U;
+    size_t retransmissions_ = 0U;
+
+    std::deque<InFlightPacket> in_flight_;
+    size_t packets_sent_ = 0U;
+    size_t bytes_sent_ = 0U;
+    size_t bytes_acked_ = 0U;
+    std::vector<uint8_t> payload_;
+    // Large enough to tell an oversized message from an ACK
+    std::array<uint8_t, 16> ack_{};
+};
+
+#endif  // VOYAGER_HOST_SESSION_HPP
@@ -10,6 +10,8 @@ class VoyagerHostMessageId(Enum):
     START = 1
     ACK = 2
     DATA = 3
+    FILL = 4
+    QUERY = 5
 
 class VoyagerTargetDfuError(Enum):
     NONE = 0
@@ -19,6 +21,11 @@ class VoyagerTargetDfuError(Enum):
     INVALID_MESSAGE_ID = 4
     SIZE_TOO_LARGE = 5
     INTERNAL_ERROR = 6
+    UNSUPPORTED_FEATURE = 7
+    INVALID_COMPRESSED_DATA = 8
+    BASE_IMAGE_MISMATCH = 9
+    INVALID_PATCH = 10
+    NO_CHECKPOINT = 11
 
 class VoyagerHostDfuError(Enum):
     NONE = 0
@@ -30,9 +37,44 @@ class VoyagerHostDfuError(Enum):
     INTERNAL_ERROR = 6
     CRC_MISMATCH = 7
     UNKNOWN_ERROR_CODE = 8
+    UNSUPPORTED_FEATURE = 9
+    INVALID_COMPRESSED_DATA = 10
+    BASE_IMAGE_MISMATCH = 11
+    INVALID_PATCH = 12
+    NO_CHECKPOINT = 13
+    TIMEOUT = 14
+    TRANSPORT_ERROR = 15
+    IMAGE_READ_ERROR = 16
 
-def generate_start_request(app_size, app_crc):
-    message_size_bytes = 8
+# START flag announcing that DATA payloads carry a stream compressed with lz_compress
+START_FLAG_COMPRESSED = 0x01
+# START flag announcing that DATA payloads carry a patch generated with generate_patch
+START_FLAG_DELTA = 0x02
+# START flag asking the target to resume the DFU from its stored checkpoint
+START_FLAG_RESUME = 0x04
+
+def generate_start_request(app_size, app_crc, window_size=None, ack_interval=None, lz_window_bits=None, base_crc=None,
+                           resume=False):
+    # A window size asks the target to accept several unacknowledged DATA packets,
+    # an ACK interval asks it to acknowledge them with a single cumulative ACK,
+    # a compression window announces that the DATA payloads carry an lz_compress stream,
+    # a base CRC that they carry a generate_patch patch against that application
+    # and resume that they continue from the offset returned by get_checkpoint_offset
+    if base_crc is not None:
+        message_size_bytes = 16
+        window_size = 1 if window_size is None else window_size
+        ack_interval = 1 if ack_interval is None else ack_interval
+    elif lz_window_bits is not None or resume:
+        message_size_bytes = 12
+        window_size = 1 if window_size is None else window_size
+        ack_interval = 1 if ack_interval is None else ack_interval
+    elif ack_interval is not None:
+        message_size_bytes = 10
+        window_size = ack_interval if window_size is None else window_size
+    elif window_size is not None:
+        message_size_bytes = 9
+    else:
+        message_size_bytes = 8
     buffer = bytearray(message_size_bytes)
 
     buffer[0] = VoyagerHostMessageId.START.value
@@ -46,29 +88,200 @@ def generate_start_request(app_size, app_crc):
     buffer[1:4] = size_array
     struct.pack_into(">I", buffer, 4, app_crc)
 
+    if window_size is not None:
+        buffer[8] = window_size
+
+    if ack_interval is not None:
+        buffer[9] = ack_interval
+
+    if lz_window_bits is not None:
+        buffer[10] = START_FLAG_COMPRESSED
+        buffer[11] = lz_window_bits
+
+    if resume:
+        buffer[10] = START_FLAG_RESUME
+
+    if base_crc is not None:
+        buffer[10] = START_FLAG_DELTA
+        struct.pack_into(">I", buffer, 12, base_crc)
+
     return buffer
 
-def generate_data_packet(payload, reset_sequence_number=False):
+def generate_query_request(app_size, app_crc):
+    # Laid out like a START message that does not negotiate any options
+    buffer = generate_start_request(app_size, app_crc)
+    buffer[0] = VoyagerHostMessageId.QUERY.value
+
+    return buffer
+
+def generate_data_packet_with_sequence(payload, sequence_number):
     payload_len = len(payload)
     buffer_len = payload_len + 2
     buffer = bytearray(buffer_len)
 
     buffer[0] = VoyagerHostMessageId.DATA.value
+    buffer[1] = sequence_number
+    buffer[2:] = payload
 
-    if reset_sequence_number:
-        generate_data_packet.sequence_number = 0
+    return buffer
 
-    buffer[1] = generate_data_packet.sequence_number
-    generate_data_packet.sequence_number = (generate_data_packet.sequence_number + 1) % 256
+class VoyagerHostGeneratorContext:
+    # Sequence number state of one DFU, so several DFUs can generate packets without sharing any state
+    def __init__(self):
+        self.next_sequence_number = 0
 
-    buffer[2:] = payload
+def generate_data_packet(context, payload):
+    buffer = generate_data_packet_with_sequence(payload, context.next_sequence_number)
+    context.next_sequence_number = (context.next_sequence_number + 1) % 256
+
+    return buffer
+
+def generate_data_packets(context, image, max_payload, packet_count):
+    # Packets are back to back, each carrying max_payload bytes of the image except the last one of the image
+    buffer = bytearray()
+    for offset in range(0, min(len(image), packet_count * max_payload), max_payload):
+        buffer += generate_data_packet(context, image[offset:offset + max_payload])
 
     return buffer
 
-generate_data_packet.sequence_number = 0
+def generate_fill_packet_with_sequence(fill_length, fill_value, sequence_number):
+    # A FILL packet stands in for a DATA packet whose payload is fill_length bytes of fill_value
+    buffer = bytearray(6)
+
+    buffer[0] = VoyagerHostMessageId.FILL.value
+    buffer[1] = sequence_number
+    buffer[2:5] = struct.pack(">I", fill_length & 0xffffff)[1:4]
+    buffer[5] = fill_value
+
+    return buffer
+
+def get_fill_run_length(data, start=0):
+    run_length = 0
+    while start + run_length < len(data) and run_length < 0xffffff and data[start + run_length] == data[start]:
+        run_length += 1
+
+    return run_length
+
+def generate_image_packet(image, max_payload, min_fill_run, sequence_number):
+    # Returns the next packet of the image and the number of bytes of the image it covers,
+    # collapsing runs of at least min_fill_run identical bytes into FILL packets
+    run_length = get_fill_run_length(image)
+    if min_fill_run > 0 and run_length >= min_fill_run:
+        return generate_fill_packet_with_sequence(run_length, image[0], sequence_number), run_length
+
+    payload_len = 0
+    while payload_len < max_payload and payload_len < len(image):
+        if min_fill_run > 0 and get_fill_run_length(image, payload_len) >= min_fill_run:
+            break
+        payload_len += 1
+
+    return generate_data_packet_with_sequence(image[:payload_len], sequence_number), payload_len
+
+def lz_compress(data, window_bits):
+    # Compresses an image into the stream a target decompresses DATA payloads with after a
+    # START carrying lz_window_bits. Groups of eight items follow a flags byte read LSB first,
+    # a set flag is a literal byte and a clear flag a big endian token holding the match
+    # offset - 1 in its upper 12 bits and the match length - 3 in its lower 4.
+    # NOTE: the match search is brute force, so large windows are slow on large images
+    MIN_MATCH = 3
+    MAX_MATCH = 18
+    assert 4 <= window_bits <= 12
+    window_size = 1 << window_bits
+
+    output = bytearray()
+    flags_index = 0
+    item = 8
+    pos = 0
+    while pos < len(data):
+        if item == 8:
+            flags_index = len(output)
+            output.append(0)
+            item = 0
+
+        # Greedily take the longest match in the window, the nearest one on a tie
+        best_length = 0
+        best_offset = 0
+        max_length = min(len(data) - pos, MAX_MATCH)
+        for offset in range(1, min(pos, window_size) + 1):
+            length = 0
+            while length < max_length and data[pos + length] == data[pos + length - offset]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_offset = offset
+                if length == max_length:
+                    break
+
+        if best_length >= MIN_MATCH:
+            output += struct.pack(">H", ((best_offset - 1) << 4) | (best_length - MIN_MATCH))
+            pos += best_length
+        else:
+            output[flags_index] |= 1 << item
+            output.append(data[pos])
+            pos += 1
+        item += 1
+
+    return output
+
+def generate_patch(old_image, new_image):
+    # The patch is a sequence of ops. COPY (0x01) is followed by a 3 byte source offset into
+    # the current application and a 3 byte length, INSERT (0x02) by a 3 byte length and that
+    # many bytes of the new application. Mirrors voyager_host_generate_patch
+    min_copy = 8
+    max_length = 0xffffff
+    max_candidates = 32
+
+    chains = {}
+    for i in range(len(old_image) - min_copy + 1):
+        chains.setdefault(bytes(old_image[i:i + min_copy]), []).append(i)
+
+    patch = bytearray()
+    insert_start = 0
+    previous_copy_end = 0
+    i = 0
+    while i <= len(new_image):
+        best_length = 0
+        best_offset = 0
+        limit = min(len(new_image) - i, max_length)
+        if i < len(new_image) and limit >= min_copy:
+            chained = chains.get(bytes(new_image[i:i + min_copy]), [])
+            candidates = [previous_copy_end, i] + chained[::-1][:max_candidates]
+            for offset in candidates:
+                if offset >= len(old_image):
+                    continue
+                length = 0
+                while length < min(len(old_image) - offset, limit) and old_image[offset + length] == new_image[i + length]:
+                    length += 1
+                if length > best_length:
+                    best_length = length
+                    best_offset = offset
+
+        copy = best_length >= min_copy
+        insert_length = i - insert_start
+        if insert_length > 0 and (copy or i == len(new_image) or insert_length == max_length):
+            patch.append(0x02)
+            patch += struct.pack(">I", insert_length)[1:4]
+            patch += new_image[insert_start:i]
+            insert_start = i
+
+        if i == len(new_image):
+            break
+
+        if copy:
+            patch.append(0x01)
+            patch += struct.pack(">I", best_offset)[1:4]
+            patch += struct.pack(">I", best_length)[1:4]
+            i += best_length
+            insert_start = i
+            previous_copy_end = best_offset + best_length
+        else:
+            i += 1
+            previous_copy_end += 1
+
+    return patch
 
 # Original CRC implementation with CRC table
-def calculate_crc(buffer):
+def calculate_crc(buffer, crc=0xffffffff):
     size = len(buffer)
     crc32_table = [
         0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005,
@@ -105,7 +318,6 @@ def calculate_crc(buffer):
         0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668, 0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
     ]
 
-    crc = 0xffffffff
     crc_size = size
 
     while (crc_size > 0):
@@ -128,7 +340,7 @@ def compare_ack_message(msg, previous_message):
     err = VoyagerTargetDfuError(msg[1])
 
     if err != VoyagerTargetDfuError.NONE:
-        return VoyagerHostDfuError(err.value)
+        return VoyagerHostDfuError[err.name]
 
     crc = calculate_crc(previous_message[1:])
     crc_from_target = struct.unpack(">I", msg[2:6])[0]
@@ -141,3 +353,41 @@ def compare_ack_message(msg, previous_message):
         return VoyagerHostDfuError.CRC_MISMATCH
 
     return VoyagerHostDfuError.NONE
+
+def get_granted_window_size(start_ack):
+    # Targets that only support stop-and-wait leave the window byte as 0
+    return max(start_ack[6], 1)
+
+def get_resume_sequence_number(nack):
+    return nack[2]
+
+def get_checkpoint_offset(query_ack):
+    # The number of application bytes the target already holds, 0 if the DFU has to start over
+    return struct.unpack_from(">I", query_ack, 2)[0]
+
+def get_granted_ack_interval(start_ack):
+    # Targets that acknowledge every DATA packet leave the interval byte as 0
+    return max(start_ack[7], 1)
+
+def compare_batched_ack_message(msg, batch_crc, last_sequence_number, batch_count):
+    # batch_crc is the CRC of every DATA packet in the batch without its message ID,
+    # e.g. calculate_crc(packet[1:], crc=batch_crc) for each packet sent
+    VOYAGER_ACK_MESSAGE_SIZE = 8
+
+    if len(msg) != VOYAGER_ACK_MESSAGE_SIZE:
+        return VoyagerHostDfuError.SIZE_TOO_LARGE
+
+    if msg[0] != VoyagerHostMessageId.ACK.value:
+        return VoyagerHostDfuError.INVALID_MESSAGE_ID
+
+    err = VoyagerTargetDfuError(msg[1])
+
+    if err != VoyagerTargetDfuError.NONE:
+        return VoyagerHostDfuError[err.name]
+
+    crc_from_target = struct.unpack(">I", msg[2:6])[0]
+
+    if crc_from_target != batch_crc or msg[6] != last_sequence_number or msg[7] != batch_count:
+        return VoyagerHostDfuError.CRC_MISMATCH
+
+    return VoyagerHostDfuError.NONE